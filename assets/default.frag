@@ -2,12 +2,15 @@
 out vec4 FragColor;
 
 in vec3 ourColor;
+in vec3 bodyColor;
 in vec3 Normal;
 in vec3 FragPos;
+in vec2 texCoord;
 
-uniform vec3 color;
 uniform vec3 lightPos;
 uniform vec3 viewPos;
+uniform sampler2D bodyTexture;
+uniform bool useTexture;
 
 void main()
 {
@@ -28,6 +31,7 @@ void main()
 	float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
 	vec3 specular = specularStrength * spec * vec3(1.0, 1.0, 1.0);
 
-	vec3 result = (ambient + diffuse + specular) * color * ourColor;
+	vec3 surface = useTexture ? texture(bodyTexture, texCoord).rgb : ourColor;
+	vec3 result = (ambient + diffuse + specular) * bodyColor * surface;
 	FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
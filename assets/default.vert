@@ -1,18 +1,26 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec4 aInstance; // xyz = body position, w = scale of the unit mesh
+layout (location = 3) in vec3 aInstanceColor;
+layout (location = 4) in vec2 aTexCoord;
+layout (location = 5) in vec3 aNormal;
 
 out vec3 ourColor;
+out vec3 bodyColor;
 out vec3 Normal;
 out vec3 FragPos;
+out vec2 texCoord;
 
-uniform mat4 model;
 uniform mat4 camMatrix;
 
 void main()
 {
-	FragPos = vec3(model * vec4(aPos, 1.0));
+	FragPos = aInstance.xyz + aPos * aInstance.w;
 	gl_Position = camMatrix * vec4(FragPos, 1.0);
 	ourColor = aColor;
-	Normal = normalize(mat3(transpose(inverse(model))) * aPos);
+	bodyColor = aInstanceColor;
+	texCoord = aTexCoord;
+	// the instance transform is a uniform scale plus a translation, so it leaves directions unchanged
+	Normal = normalize(aNormal);
 }
\ No newline at end of file
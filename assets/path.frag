@@ -0,0 +1,12 @@
+#version 330 core
+out vec4 FragColor;
+
+in float progress;
+
+uniform vec3 pathColor;
+
+void main()
+{
+	// Solid near the body, fading towards the end of the prediction
+	FragColor = vec4(pathColor, 1.0 - 0.7 * progress);
+}
\ No newline at end of file
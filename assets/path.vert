@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 camMatrix;
+
+out float progress;
+
+uniform int pointCount;
+
+void main()
+{
+	gl_Position = camMatrix * vec4(aPos, 1.0);
+	// 0 at the body, 1 at the end of the prediction
+	progress = float(gl_VertexID) / float(max(pointCount - 1, 1));
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 330 core
+out vec4 FragColor;
+
+in float age;
+
+uniform vec3 trailColor;
+
+void main()
+{
+	// Fully visible at the body, fading out towards the oldest sample
+	FragColor = vec4(trailColor, 0.8 * (1.0 - age));
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 330 core
+// Trails have no vertex attributes: gl_InstanceID is the body and gl_VertexID counts back from the newest sample
+uniform samplerBuffer samples;
+uniform mat4 camMatrix;
+uniform int head;
+uniform int length;
+uniform int stride;
+uniform int filled;
+
+out float age;
+
+void main()
+{
+	int slot = (head - gl_VertexID + length) % length;
+	vec3 position = texelFetch(samples, slot * stride + gl_InstanceID).xyz;
+	gl_Position = camMatrix * vec4(position, 1.0);
+	age = float(gl_VertexID) / float(filled - 1);
+}
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include"BodyQuery.h"
+
+#include<algorithm>
+#include<charconv>
+#include<cmath>
+#include<string_view>
+
+#include"Tracer.h"
+
+namespace
+{
+	// Rows filtered between checks for a newer query
+	const size_t chunkSize = 4096;
+
+	// The search box either names a range of IDs or a digit sequence the ID has to contain
+	struct Search
+	{
+		bool any = true;
+		bool range = false;
+		uint64_t first = 0;
+		uint64_t last = 0;
+		std::string_view digits;
+	};
+
+	Search parseSearch(std::string_view text)
+	{
+		Search search;
+		while (!text.empty() && text.front() == ' ')
+		{
+			text.remove_prefix(1);
+		}
+		while (!text.empty() && text.back() == ' ')
+		{
+			text.remove_suffix(1);
+		}
+		if (text.empty())
+		{
+			return search;
+		}
+		search.any = false;
+
+		size_t dash = text.find('-');
+		if (dash != std::string_view::npos)
+		{
+			std::string_view from = text.substr(0, dash);
+			std::string_view to = text.substr(dash + 1);
+			std::from_chars(from.data(), from.data() + from.size(), search.first);
+			search.last = UINT64_MAX;
+			if (!to.empty())
+			{
+				std::from_chars(to.data(), to.data() + to.size(), search.last);
+			}
+			search.range = true;
+			return search;
+		}
+		search.digits = text;
+		return search;
+	}
+
+	bool matches(const Search& search, uint32_t id)
+	{
+		if (search.any)
+		{
+			return true;
+		}
+		if (search.range)
+		{
+			return id >= search.first && id <= search.last;
+		}
+		char buffer[16];
+		std::to_chars_result written = std::to_chars(buffer, buffer + sizeof(buffer), id);
+		return std::string_view(buffer, written.ptr - buffer).find(search.digits) != std::string_view::npos;
+	}
+
+	double length(const double* vector)
+	{
+		return std::sqrt(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]);
+	}
+
+	// Value the body at index is sorted by
+	double sortKey(const BodyQuerySource& source, size_t index, int column)
+	{
+		const SnapshotData& state = *source.state;
+		switch (column)
+		{
+		case sortByPosition: return length(&state.positions[3 * index]);
+		case sortByVelocity: return length(&state.velocities[3 * index]);
+		case sortByForce: return source.forces[index];
+		case sortByMass: return state.masses[index];
+		case sortByRadius: return state.radii[index];
+		default: return static_cast<double>(source.handles[index].slot);
+		}
+	}
+}
+
+// Starts the worker thread
+BodyQuery::BodyQuery()
+{
+	worker = std::thread(&BodyQuery::WorkerLoop, this);
+}
+
+// Stops the worker
+BodyQuery::~BodyQuery()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+// Queues a query over a capture of the bodies, replacing any query that has not finished
+void BodyQuery::Submit(std::shared_ptr<const BodyQuerySource> source, int sortColumn, const std::string& search,
+	double minMass, double maxMass, bool descending)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.generation = ++submitted;
+		pending.source = std::move(source);
+		pending.sortColumn = sortColumn;
+		pending.search = search;
+		pending.minMass = minMass;
+		pending.maxMass = maxMass;
+		pending.descending = descending;
+		hasPending = true;
+	}
+	wake.notify_one();
+}
+
+// Takes the newest finished result, returns true if the order changed
+bool BodyQuery::Poll()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!hasFinished)
+	{
+		return false;
+	}
+	// The old vector goes back to the worker so neither side reallocates in a steady state
+	handles.swap(finished);
+	hasFinished = false;
+	return true;
+}
+
+// Whether a submitted query has not finished yet
+bool BodyQuery::Busy() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return completed != submitted;
+}
+
+// Runs queued jobs until the query is destroyed
+void BodyQuery::WorkerLoop()
+{
+	Tracer::NameThread("Body query");
+	Job job;
+	std::vector<Row> rows;
+	std::vector<BodyHandle> result;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || hasPending; });
+			if (stopping)
+			{
+				return;
+			}
+			std::swap(job, pending);
+			hasPending = false;
+		}
+
+		TraceZone zone("Filter and sort bodies");
+		bool done = Run(job, rows, result);
+		job.source.reset(); // the capture is released as soon as it is not needed
+		if (!done)
+		{
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (job.generation == submitted)
+		{
+			finished.swap(result);
+			hasFinished = true;
+			completed = job.generation;
+		}
+	}
+}
+
+// Filters and sorts one job, returns false if a newer job arrived meanwhile
+bool BodyQuery::Run(const Job& job, std::vector<Row>& rows, std::vector<BodyHandle>& result) const
+{
+	Search search = parseSearch(job.search);
+	rows.clear();
+	if (job.source == nullptr)
+	{
+		result.clear();
+		return true;
+	}
+	const BodyQuerySource& source = *job.source;
+	const std::vector<double>& masses = source.state->masses;
+
+	// Filter into the rows, a chunk at a time so a newer query does not wait for a stale one
+	for (size_t start = 0; start < source.handles.size(); start += chunkSize)
+	{
+		if (!Current(job))
+		{
+			return false;
+		}
+		size_t end = std::min(start + chunkSize, source.handles.size());
+		for (size_t i = start; i < end; i++)
+		{
+			if (!matches(search, source.handles[i].slot)
+				|| (job.minMass > 0.0 && masses[i] < job.minMass)
+				|| (job.maxMass > 0.0 && masses[i] > job.maxMass))
+			{
+				continue;
+			}
+			rows.push_back({ source.handles[i], sortKey(source, i, job.sortColumn) });
+		}
+	}
+
+	if (!Current(job))
+	{
+		return false;
+	}
+	// Ties keep ID order so rows with equal keys do not jump around between refreshes
+	bool descending = job.descending;
+	std::sort(rows.begin(), rows.end(), [descending](const Row& a, const Row& b) {
+		if (a.sortKey != b.sortKey)
+		{
+			return descending ? a.sortKey > b.sortKey : a.sortKey < b.sortKey;
+		}
+		return a.handle.slot < b.handle.slot;
+	});
+
+	result.resize(rows.size());
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		result[i] = rows[i].handle;
+	}
+	return true;
+}
+
+// Whether job is still the newest submission
+bool BodyQuery::Current(const Job& job) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return job.generation == submitted;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#ifndef BODY_QUERY_CLASS_H
+#define BODY_QUERY_CLASS_H
+
+#include<condition_variable>
+#include<cstdint>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<thread>
+#include<vector>
+
+#include"BodyStore.h"
+#include"Snapshot.h"
+
+// A capture of the bodies for the query to read on its worker. The state is the same capture the rewind
+// buffer compresses, so the UI thread does not copy the bodies for the table on its own; the handles and
+// force magnitudes a snapshot lacks are taken in the same pass. Immutable once submitted.
+struct BodyQuerySource
+{
+	std::shared_ptr<const SnapshotData> state;
+	std::vector<BodyHandle> handles; // handle of the body at each index of state
+	std::vector<double> forces;      // length of the force on each body
+	uint64_t revision = 0;           // BodyStore::Revision when the capture was taken
+};
+
+// Columns of the body editor the query sorts by
+enum BodySortColumn
+{
+	sortById,
+	sortByPosition,
+	sortByVelocity,
+	sortByForce,
+	sortByMass,
+	sortByRadius
+};
+
+// Filters and sorts the rows of the body editor on a worker thread, so the table only ever
+// touches the rows it shows. Submitting a new query abandons the one in flight; the table keeps
+// showing the last finished order until the new one is ready. Rows are handles rather than indices,
+// since removing a body moves others to new indices.
+class BodyQuery
+{
+public:
+	// Starts the worker thread
+	BodyQuery();
+	// Stops the worker
+	~BodyQuery();
+
+	BodyQuery(const BodyQuery&) = delete;
+	BodyQuery& operator=(const BodyQuery&) = delete;
+
+	// Queues a query over a capture of the bodies. search matches a substring of the body ID, its handle's
+	// slot, or an inclusive ID range written as "first-last"; a mass bound of zero means no bound.
+	void Submit(std::shared_ptr<const BodyQuerySource> source, int sortColumn, const std::string& search,
+		double minMass, double maxMass, bool descending);
+
+	// Takes the newest finished result, returns true if the order changed
+	bool Poll();
+	// Bodies in display order, from the last finished query; some may have been removed since
+	const std::vector<BodyHandle>& Handles() const { return handles; }
+	// Whether a submitted query has not finished yet
+	bool Busy() const;
+
+private:
+	struct Job
+	{
+		uint64_t generation;
+		std::shared_ptr<const BodyQuerySource> source;
+		int sortColumn;
+		std::string search;
+		double minMass;
+		double maxMass;
+		bool descending;
+	};
+
+	// Runs queued jobs until the query is destroyed
+	void WorkerLoop();
+	// What the worker keeps of one body while sorting
+	struct Row
+	{
+		BodyHandle handle;
+		double sortKey;
+	};
+
+	// Filters and sorts one job, returns false if a newer job arrived meanwhile
+	bool Run(const Job& job, std::vector<Row>& rows, std::vector<BodyHandle>& result) const;
+	// Whether job is still the newest submission
+	bool Current(const Job& job) const;
+
+	std::vector<BodyHandle> handles;
+
+	// Shared with the worker
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	Job pending;
+	bool hasPending = false;
+	uint64_t submitted = 0;
+	uint64_t completed = 0;
+	std::vector<BodyHandle> finished;
+	bool hasFinished = false;
+	bool stopping = false;
+	std::thread worker;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,220 @@
+#ifndef BODY_STORE_CLASS_H
+#define BODY_STORE_CLASS_H
+
+#include<algorithm>
+#include<cstddef>
+#include<cstdint>
+#include<utility>
+#include<vector>
+
+// Refers to one body for as long as it exists. The slot is reused once the body is removed, but with
+// a new generation, so a handle kept from before never finds the body that took the slot over.
+struct BodyHandle
+{
+	uint32_t slot = UINT32_MAX;
+	uint32_t generation = 0;
+
+	bool operator==(const BodyHandle& other) const { return slot == other.slot && generation == other.generation; }
+	bool operator!=(const BodyHandle& other) const { return !(*this == other); }
+};
+
+// Told by a BodyStore when bodies come and go, so indexes over the bodies can follow
+class BodyStoreListener
+{
+public:
+	virtual ~BodyStoreListener() = default;
+	// count bodies were appended at dense indices [first, first + count); nothing else moved
+	virtual void BodiesInserted(size_t first, size_t count) = 0;
+	// Bodies were removed; the ones left may have moved to other dense indices
+	virtual void BodiesRemoved() = 0;
+};
+
+// Keeps bodies packed in one array for the physics loops and hands out generational handles that stay
+// valid while other bodies are added and removed. Inserting and removing a batch costs time in the size
+// of the batch: removal moves the last bodies into the holes instead of shifting everything after them.
+// Dense indices therefore change on removal; anything kept across frames should hold a handle.
+template<class Body>
+class BodyStore
+{
+public:
+	size_t Size() const { return bodies.size(); }
+	bool Empty() const { return bodies.empty(); }
+	// Changes whenever bodies are added or removed, so copies of the handles can tell they are out of date
+	uint64_t Revision() const { return revision; }
+	Body& operator[](size_t index) { return bodies[index]; }
+	const Body& operator[](size_t index) const { return bodies[index]; }
+	Body* begin() { return bodies.data(); }
+	Body* end() { return bodies.data() + bodies.size(); }
+	const Body* begin() const { return bodies.data(); }
+	const Body* end() const { return bodies.data() + bodies.size(); }
+
+	// Makes room for count bodies in total, so the next inserts do not reallocate
+	void Reserve(size_t count)
+	{
+		bodies.reserve(count);
+		denseSlots.reserve(count);
+	}
+
+	// Adds one body built from args and returns its handle
+	template<class... Args>
+	BodyHandle Emplace(Args&&... args)
+	{
+		size_t first = bodies.size();
+		bodies.emplace_back(std::forward<Args>(args)...);
+		BodyHandle handle = AllocateSlot(first);
+		Notify(first, 1);
+		return handle;
+	}
+
+	// Appends count bodies in one go; their handles go to handles if it is not null
+	void Insert(const Body* batch, size_t count, BodyHandle* handles = nullptr)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		size_t first = bodies.size();
+		// grow geometrically even when a batch asks for less, so repeated small batches stay amortized
+		if (first + count > bodies.capacity())
+		{
+			Reserve(std::max(first + count, bodies.capacity() * 2));
+		}
+		bodies.insert(bodies.end(), batch, batch + count);
+		for (size_t i = 0; i < count; i++)
+		{
+			BodyHandle handle = AllocateSlot(first + i);
+			if (handles != nullptr)
+			{
+				handles[i] = handle;
+			}
+		}
+		Notify(first, count);
+	}
+
+	// Removes the bodies of a batch of handles; handles that are stale or repeated are skipped
+	void Remove(const BodyHandle* handles, size_t count)
+	{
+		bool removed = false;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!Valid(handles[i]))
+			{
+				continue;
+			}
+			uint32_t slot = handles[i].slot;
+			size_t index = slotDense[slot];
+			size_t last = bodies.size() - 1;
+			if (index != last)
+			{
+				bodies[index] = std::move(bodies[last]);
+				denseSlots[index] = denseSlots[last];
+				slotDense[denseSlots[index]] = static_cast<uint32_t>(index);
+			}
+			bodies.pop_back();
+			denseSlots.pop_back();
+			slotGeneration[slot]++;
+			freeSlots.push_back(slot);
+			removed = true;
+		}
+		if (removed)
+		{
+			revision++;
+			for (BodyStoreListener* listener : listeners)
+			{
+				listener->BodiesRemoved();
+			}
+		}
+	}
+
+	// Removes every body; all handles become stale
+	void Clear()
+	{
+		for (uint32_t slot : denseSlots)
+		{
+			slotGeneration[slot]++;
+			freeSlots.push_back(slot);
+		}
+		bodies.clear();
+		denseSlots.clear();
+		revision++;
+		for (BodyStoreListener* listener : listeners)
+		{
+			listener->BodiesRemoved();
+		}
+	}
+
+	// Whether a handle still refers to a body
+	bool Valid(BodyHandle handle) const
+	{
+		return handle.slot < slotGeneration.size() && slotGeneration[handle.slot] == handle.generation
+			&& slotDense[handle.slot] < bodies.size() && denseSlots[slotDense[handle.slot]] == handle.slot;
+	}
+
+	// The body a handle refers to, or nullptr if it was removed
+	Body* Get(BodyHandle handle) { return Valid(handle) ? &bodies[slotDense[handle.slot]] : nullptr; }
+	const Body* Get(BodyHandle handle) const { return Valid(handle) ? &bodies[slotDense[handle.slot]] : nullptr; }
+
+	// The current dense index of a body, or SIZE_MAX if it was removed
+	size_t IndexOf(BodyHandle handle) const { return Valid(handle) ? slotDense[handle.slot] : SIZE_MAX; }
+
+	// The handle of the body at a dense index
+	BodyHandle HandleAt(size_t index) const
+	{
+		uint32_t slot = denseSlots[index];
+		return { slot, slotGeneration[slot] };
+	}
+
+	// Bytes held for the bodies and their handle tables, including reserved room
+	size_t MemoryBytes() const
+	{
+		return bodies.capacity() * sizeof(Body)
+			+ (denseSlots.capacity() + slotDense.capacity() + slotGeneration.capacity() + freeSlots.capacity()) * sizeof(uint32_t);
+	}
+
+	// Listeners are told about every later insert and removal until they are taken off again
+	void AddListener(BodyStoreListener* listener) { listeners.push_back(listener); }
+	void RemoveListener(BodyStoreListener* listener)
+	{
+		listeners.erase(std::remove(listeners.begin(), listeners.end(), listener), listeners.end());
+	}
+
+private:
+	std::vector<Body> bodies;          // packed, in dense index order
+	std::vector<uint32_t> denseSlots;  // slot of the body at each dense index
+	std::vector<uint32_t> slotDense;   // dense index of the body in each slot
+	std::vector<uint32_t> slotGeneration;
+	std::vector<uint32_t> freeSlots;
+	std::vector<BodyStoreListener*> listeners;
+	uint64_t revision = 0;
+
+	// Gives the body at a dense index a slot, reusing a free one first
+	BodyHandle AllocateSlot(size_t index)
+	{
+		uint32_t slot;
+		if (!freeSlots.empty())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+			slotDense[slot] = static_cast<uint32_t>(index);
+		}
+		else
+		{
+			slot = static_cast<uint32_t>(slotDense.size());
+			slotDense.push_back(static_cast<uint32_t>(index));
+			slotGeneration.push_back(0);
+		}
+		denseSlots.push_back(slot);
+		return { slot, slotGeneration[slot] };
+	}
+
+	void Notify(size_t first, size_t count)
+	{
+		revision++;
+		for (BodyStoreListener* listener : listeners)
+		{
+			listener->BodiesInserted(first, count);
+		}
+	}
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,296 @@
+#include"BufferManager.h"
+
+#include<algorithm>
+#include<iterator>
+#include<utility>
+
+// Starts with the whole capacity as one free range
+RangeAllocator::RangeAllocator(GLuint capacity)
+	: capacity(capacity)
+{
+	if (capacity > 0)
+	{
+		freeRanges[0] = capacity;
+	}
+}
+
+// Returns the offset of a free range of the given size, or -1 if no free range is large enough
+GLint RangeAllocator::Allocate(GLuint count)
+{
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+	{
+		if (it->second < count)
+		{
+			continue;
+		}
+		GLuint offset = it->first;
+		GLuint remaining = it->second - count;
+		freeRanges.erase(it);
+		if (remaining > 0)
+		{
+			freeRanges[offset + count] = remaining;
+		}
+		used += count;
+		return static_cast<GLint>(offset);
+	}
+	return -1;
+}
+
+// Gives a range back so later allocations can reuse it
+void RangeAllocator::Free(GLuint offset, GLuint count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+	used -= count;
+
+	auto next = freeRanges.lower_bound(offset);
+	// Merge with the free range that ends where this one starts
+	if (next != freeRanges.begin())
+	{
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			count += prev->second;
+			freeRanges.erase(prev);
+		}
+	}
+	// Merge with the free range that starts where this one ends
+	if (next != freeRanges.end() && offset + count == next->first)
+	{
+		count += next->second;
+		freeRanges.erase(next);
+	}
+	freeRanges[offset] = count;
+}
+
+// Extends the capacity, appending the new space to the free list
+void RangeAllocator::Grow(GLuint newCapacity)
+{
+	if (newCapacity <= capacity)
+	{
+		return;
+	}
+	GLuint oldCapacity = capacity;
+	capacity = newCapacity;
+	// Free() subtracts from used, so count the new space as used first
+	used += newCapacity - oldCapacity;
+	Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+Mesh::Mesh(BufferManager* owner, const MeshRange& range)
+	: owner(owner), range(range)
+{
+}
+
+// Gives the range back when the mesh goes out of scope
+Mesh::~Mesh()
+{
+	Release();
+}
+
+// Takes over the range of another Mesh, leaving it empty
+Mesh::Mesh(Mesh&& other) noexcept
+	: owner(other.owner), range(other.range)
+{
+	other.owner = nullptr;
+}
+
+// Releases the current range and takes over the range of another Mesh
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+	if (this != &other)
+	{
+		Release();
+		owner = other.owner;
+		range = other.range;
+		other.owner = nullptr;
+	}
+	return *this;
+}
+
+// Draws the mesh; the owning BufferManager must be bound
+void Mesh::Draw(GLenum mode) const
+{
+	if (owner != nullptr)
+	{
+		owner->Draw(range, mode);
+	}
+}
+
+// Returns the range to the BufferManager early
+void Mesh::Release()
+{
+	if (owner != nullptr)
+	{
+		owner->Free(range);
+		owner = nullptr;
+	}
+}
+
+// Creates the shared buffers with room for the given number of vertices and indices
+BufferManager::BufferManager(GLsizei vertexSize, GLuint vertexCapacity, GLuint indexCapacity)
+	: vertexSize(vertexSize),
+	  vbo(nullptr, static_cast<GLsizeiptr>(vertexCapacity) * vertexSize),
+	  ebo(nullptr, static_cast<GLsizeiptr>(indexCapacity) * sizeof(GLuint)),
+	  vertexRanges(vertexCapacity),
+	  indexRanges(indexCapacity)
+{
+	vbo.Unbind();
+	// The element buffer binding is part of the VAO state
+	vao.Bind();
+	ebo.Bind();
+	vao.Unbind();
+	ebo.Unbind();
+}
+
+// Describes a vertex attribute of the shared layout, like VAO::LinkAttrib
+void BufferManager::LinkAttrib(GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr offset)
+{
+	attribs.push_back({ nullptr, layout, numComponents, type, vertexSize, offset, 0 });
+	LinkAttribs();
+}
+
+// Links a per-instance attribute read from a separate buffer, advancing once per instance
+void BufferManager::LinkInstanceAttrib(VBO& instances, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, GLsizeiptr offset)
+{
+	attribs.push_back({ &instances, layout, numComponents, type, stride, offset, 1 });
+	LinkAttribs();
+}
+
+// Copies a mesh into the shared buffers, growing them if needed
+Mesh BufferManager::Allocate(const GLfloat* vertices, GLuint vertexCount, const GLuint* indices, GLsizei indexCount)
+{
+	GLint baseVertex = vertexRanges.Allocate(vertexCount);
+	if (baseVertex < 0)
+	{
+		GrowVertices(vertexRanges.Capacity() + vertexCount);
+		baseVertex = vertexRanges.Allocate(vertexCount);
+	}
+	GLint firstIndex = indexRanges.Allocate(indexCount);
+	if (firstIndex < 0)
+	{
+		GrowIndices(indexRanges.Capacity() + indexCount);
+		firstIndex = indexRanges.Allocate(indexCount);
+	}
+
+	// Upload through the copy target so neither the bound VAO nor its element buffer is disturbed
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vbo.ID);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(baseVertex) * vertexSize,
+		static_cast<GLsizeiptr>(vertexCount) * vertexSize, vertices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ebo.ID);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(firstIndex) * sizeof(GLuint),
+		static_cast<GLsizeiptr>(indexCount) * sizeof(GLuint), indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	MeshRange range;
+	range.baseVertex = baseVertex;
+	range.vertexCount = vertexCount;
+	range.firstIndex = static_cast<GLuint>(firstIndex);
+	range.indexCount = indexCount;
+	return Mesh(this, range);
+}
+
+// Gives the ranges of a mesh back; called by Mesh
+void BufferManager::Free(const MeshRange& range)
+{
+	vertexRanges.Free(static_cast<GLuint>(range.baseVertex), range.vertexCount);
+	indexRanges.Free(range.firstIndex, static_cast<GLuint>(range.indexCount));
+}
+
+// Draws one mesh with its base-vertex offset; the manager must be bound
+void BufferManager::Draw(const MeshRange& range, GLenum mode)
+{
+	glDrawElementsBaseVertex(mode, range.indexCount, GL_UNSIGNED_INT,
+		(void*)(static_cast<GLintptr>(range.firstIndex) * sizeof(GLuint)), range.baseVertex);
+}
+
+// Makes instance 0 of the next draw read element firstInstance of the instance buffers; the manager must be bound
+void BufferManager::SetFirstInstance(GLuint firstInstance)
+{
+	for (const Attrib& attrib : attribs)
+	{
+		if (attrib.divisor == 0)
+		{
+			continue;
+		}
+		attrib.source->Bind();
+		GLsizeiptr offset = attrib.offset + static_cast<GLsizeiptr>(firstInstance) * attrib.stride;
+		glVertexAttribPointer(attrib.layout, attrib.numComponents, attrib.type, GL_FALSE, attrib.stride, (void*)offset);
+		attrib.source->Unbind();
+	}
+}
+
+// Binds the shared VAO
+void BufferManager::Bind()
+{
+	vao.Bind();
+}
+
+// Unbinds the shared VAO
+void BufferManager::Unbind()
+{
+	vao.Unbind();
+}
+
+// Deletes the shared GL objects
+void BufferManager::Delete()
+{
+	vao.Delete();
+	vbo.Delete();
+	ebo.Delete();
+}
+
+// Replaces the vertex buffer with a larger one, copying the old contents on the GPU
+void BufferManager::GrowVertices(GLuint minCapacity)
+{
+	GLuint oldCapacity = vertexRanges.Capacity();
+	GLuint newCapacity = std::max(minCapacity, oldCapacity * 2);
+
+	VBO grown(nullptr, static_cast<GLsizeiptr>(newCapacity) * vertexSize);
+	grown.Unbind();
+	glBindBuffer(GL_COPY_READ_BUFFER, vbo.ID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, grown.ID);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(oldCapacity) * vertexSize);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	vbo = std::move(grown);
+	vertexRanges.Grow(newCapacity);
+	LinkAttribs();
+}
+
+// Replaces the index buffer with a larger one, copying the old contents on the GPU
+void BufferManager::GrowIndices(GLuint minCapacity)
+{
+	GLuint oldCapacity = indexRanges.Capacity();
+	GLuint newCapacity = std::max(minCapacity, oldCapacity * 2);
+
+	// Creating the EBO binds it, so do it with our VAO bound to make it the new element buffer
+	vao.Bind();
+	EBO grown(nullptr, static_cast<GLsizeiptr>(newCapacity) * sizeof(GLuint));
+	vao.Unbind();
+	glBindBuffer(GL_COPY_READ_BUFFER, ebo.ID);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, grown.ID);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(oldCapacity) * sizeof(GLuint));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	ebo = std::move(grown);
+	indexRanges.Grow(newCapacity);
+}
+
+// Points every attribute at its current buffer
+void BufferManager::LinkAttribs()
+{
+	vao.Bind();
+	for (const Attrib& attrib : attribs)
+	{
+		VBO& source = attrib.source != nullptr ? *attrib.source : vbo;
+		vao.LinkAttrib(source, attrib.layout, attrib.numComponents, attrib.type, attrib.stride, (void*)attrib.offset);
+		glVertexAttribDivisor(attrib.layout, attrib.divisor);
+	}
+	vao.Unbind();
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#ifndef BUFFER_MANAGER_CLASS_H
+#define BUFFER_MANAGER_CLASS_H
+
+#include<glad/glad.h>
+#include<map>
+#include<vector>
+
+#include"VAO.h"
+#include"VBO.h"
+#include"EBO.h"
+
+// Hands out [offset, offset + count) ranges of a fixed capacity using first-fit, merging neighbours on free
+class RangeAllocator
+{
+public:
+	explicit RangeAllocator(GLuint capacity);
+
+	// Returns the offset of a free range of the given size, or -1 if no free range is large enough
+	GLint Allocate(GLuint count);
+	// Gives a range back so later allocations can reuse it
+	void Free(GLuint offset, GLuint count);
+	// Extends the capacity, appending the new space to the free list
+	void Grow(GLuint newCapacity);
+
+	GLuint Capacity() const { return capacity; }
+	GLuint Used() const { return used; }
+
+private:
+	// offset -> count of every free range, kept sorted so neighbours can be merged
+	std::map<GLuint, GLuint> freeRanges;
+	GLuint capacity;
+	GLuint used = 0;
+};
+
+// Location of one mesh inside the shared buffers of a BufferManager
+struct MeshRange
+{
+	GLint baseVertex = 0;
+	GLuint vertexCount = 0;
+	GLuint firstIndex = 0;
+	GLsizei indexCount = 0;
+};
+
+class BufferManager;
+
+// Owns a MeshRange and gives it back to its BufferManager when destroyed
+class Mesh
+{
+public:
+	Mesh() = default;
+	Mesh(BufferManager* owner, const MeshRange& range);
+	~Mesh();
+
+	// A Mesh owns its range, so it can be moved but never copied
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+	Mesh(Mesh&& other) noexcept;
+	Mesh& operator=(Mesh&& other) noexcept;
+
+	// Draws the mesh; the owning BufferManager must be bound
+	void Draw(GLenum mode = GL_TRIANGLES) const;
+	// Returns the range to the BufferManager early
+	void Release();
+
+	bool Valid() const { return owner != nullptr; }
+	const MeshRange& Range() const { return range; }
+
+private:
+	BufferManager* owner = nullptr;
+	MeshRange range;
+};
+
+// Packs many small indexed meshes into one shared vertex buffer and one shared index buffer.
+// Meshes are drawn with base-vertex offsets, so a single VAO serves all of them and creating
+// or destroying a mesh never creates or deletes GL objects.
+class BufferManager
+{
+public:
+	// vertexSize is the stride of one vertex in bytes; capacities are in vertices and indices
+	BufferManager(GLsizei vertexSize, GLuint vertexCapacity, GLuint indexCapacity);
+
+	// A BufferManager is referenced by every Mesh it hands out, so it is neither copied nor moved
+	BufferManager(const BufferManager&) = delete;
+	BufferManager& operator=(const BufferManager&) = delete;
+
+	// Describes a vertex attribute of the shared layout, like VAO::LinkAttrib
+	void LinkAttrib(GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr offset);
+	// Links a per-instance attribute read from a separate buffer, advancing once per instance
+	void LinkInstanceAttrib(VBO& instances, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, GLsizeiptr offset);
+
+	// Copies a mesh into the shared buffers, growing them if needed
+	Mesh Allocate(const GLfloat* vertices, GLuint vertexCount, const GLuint* indices, GLsizei indexCount);
+	// Gives the ranges of a mesh back; called by Mesh
+	void Free(const MeshRange& range);
+
+	// Draws one mesh with its base-vertex offset; the manager must be bound
+	void Draw(const MeshRange& range, GLenum mode = GL_TRIANGLES);
+	// Makes instance 0 of the next draw read element firstInstance of the instance buffers; the manager must be bound.
+	// GL 3.3 draw calls have no baseInstance parameter, so this does the same by moving the attribute pointers.
+	void SetFirstInstance(GLuint firstInstance);
+
+	// Binds the shared VAO
+	void Bind();
+	// Unbinds the shared VAO
+	void Unbind();
+	// Deletes the shared GL objects
+	void Delete();
+
+	GLuint VertexCapacity() const { return vertexRanges.Capacity(); }
+	GLuint VerticesUsed() const { return vertexRanges.Used(); }
+	GLuint IndexCapacity() const { return indexRanges.Capacity(); }
+	GLuint IndicesUsed() const { return indexRanges.Used(); }
+
+private:
+	struct Attrib
+	{
+		// nullptr for the shared vertex buffer
+		VBO* source;
+		GLuint layout;
+		GLuint numComponents;
+		GLenum type;
+		GLsizeiptr stride;
+		GLsizeiptr offset;
+		GLuint divisor;
+	};
+
+	// Replaces a buffer with a larger one, copying the old contents on the GPU
+	void GrowVertices(GLuint minCapacity);
+	void GrowIndices(GLuint minCapacity);
+	// Points every attribute at its current buffer
+	void LinkAttribs();
+
+	GLsizei vertexSize;
+	VAO vao;
+	VBO vbo;
+	EBO ebo;
+	RangeAllocator vertexRanges;
+	RangeAllocator indexRanges;
+	std::vector<Attrib> attribs;
+};
+
+#endif
\ No newline at end of file
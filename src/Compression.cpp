@@ -0,0 +1,98 @@
+#include"Compression.h"
+
+#include<cstring>
+
+namespace
+{
+	void writeRunLength(std::vector<uint8_t>& out, size_t run)
+	{
+		while (run >= 0x80)
+		{
+			out.push_back(static_cast<uint8_t>(run | 0x80));
+			run >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(run));
+	}
+
+	bool readRunLength(const uint8_t*& data, const uint8_t* end, size_t& run)
+	{
+		run = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (data == end)
+			{
+				return false;
+			}
+			uint8_t byte = *data++;
+			run |= static_cast<size_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+// Appends the compressed form of count words to out
+void compressWords(const uint64_t* words, size_t count, std::vector<uint8_t>& out)
+{
+	// Typical data keeps two or three planes, callers reusing out stop reallocating after the first frames
+	out.reserve(out.size() + count * 3);
+	for (int plane = 0; plane < 8; plane++)
+	{
+		int shift = plane * 8;
+		size_t i = 0;
+		while (i < count)
+		{
+			uint8_t byte = static_cast<uint8_t>(words[i] >> shift);
+			if (byte != 0)
+			{
+				out.push_back(byte);
+				i++;
+				continue;
+			}
+			size_t run = 1;
+			while (i + run < count && static_cast<uint8_t>(words[i + run] >> shift) == 0)
+			{
+				run++;
+			}
+			out.push_back(0);
+			writeRunLength(out, run);
+			i += run;
+		}
+	}
+}
+
+// Decodes exactly count words from what compressWords wrote; returns false if the data is malformed
+bool decompressWords(const uint8_t* data, size_t size, uint64_t* words, size_t count)
+{
+	const uint8_t* end = data + size;
+	std::memset(words, 0, count * sizeof(uint64_t));
+	for (int plane = 0; plane < 8; plane++)
+	{
+		int shift = plane * 8;
+		size_t i = 0;
+		while (i < count)
+		{
+			if (data == end)
+			{
+				return false;
+			}
+			uint8_t byte = *data++;
+			if (byte != 0)
+			{
+				words[i++] |= static_cast<uint64_t>(byte) << shift;
+				continue;
+			}
+			// zeros are already in place, only the position moves
+			size_t run;
+			if (!readRunLength(data, end, run) || run == 0 || run > count - i)
+			{
+				return false;
+			}
+			i += run;
+		}
+	}
+	return data == end;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef COMPRESSION_CLASS_H
+#define COMPRESSION_CLASS_H
+
+#include<cstddef>
+#include<cstdint>
+#include<vector>
+
+// Small lossless codec for arrays of 64-bit words that are mostly small: differences of quantized
+// positions, or XORs of doubles against a reference. The words are split into eight byte planes
+// (byte shuffling), so the high bytes of small values form long runs of zeros, which are then
+// stored as a single zero byte plus a run length. Used by the trajectory writer and the rewind buffer.
+
+// Maps signed differences to unsigned words so small negative values stay small
+inline uint64_t zigzagEncode(int64_t value)
+{
+	return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value)
+{
+	return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Appends the compressed form of count words to out
+void compressWords(const uint64_t* words, size_t count, std::vector<uint8_t>& out);
+
+// Decodes exactly count words from what compressWords wrote; returns false if the data is malformed
+bool decompressWords(const uint8_t* data, size_t size, uint64_t* words, size_t count);
+
+#endif
\ No newline at end of file
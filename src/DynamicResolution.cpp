@@ -0,0 +1,59 @@
+#include"DynamicResolution.h"
+
+#include<algorithm>
+
+namespace
+{
+	// Frames to wait after a change so the average reflects the new settings
+	const int settleFrames = 30;
+	// Weight of the newest frame in the moving average
+	const float smoothing = 0.1f;
+	// Headroom needed before quality goes back up, so it does not flip back and forth
+	const float raiseBelow = 0.75f;
+	const float lowerAbove = 1.05f;
+	const float scaleStep = 1.1f;
+}
+
+// Feeds the time of the last frame and adjusts the scale and sample count
+void DynamicResolution::Update(float frameMs)
+{
+	averageMs = averageMs == 0.0f ? frameMs : averageMs + (frameMs - averageMs) * smoothing;
+	samples = std::min(samples, maxSamples);
+	if (!enabled || ++framesSinceChange < settleFrames)
+	{
+		return;
+	}
+
+	if (averageMs > budgetMs * lowerAbove)
+	{
+		if (samples > 0)
+		{
+			samples /= 2;
+		}
+		else if (scale > minScale)
+		{
+			scale = std::max(minScale, scale / scaleStep);
+		}
+		else
+		{
+			return;
+		}
+		framesSinceChange = 0;
+	}
+	else if (averageMs < budgetMs * raiseBelow)
+	{
+		if (scale < 1.0f)
+		{
+			scale = std::min(1.0f, scale * scaleStep);
+		}
+		else if (samples < maxSamples)
+		{
+			samples = std::min(maxSamples, samples == 0 ? 2 : samples * 2);
+		}
+		else
+		{
+			return;
+		}
+		framesSinceChange = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef DYNAMIC_RESOLUTION_CLASS_H
+#define DYNAMIC_RESOLUTION_CLASS_H
+
+// Picks the render scale and MSAA sample count that keep the measured frame time under a budget.
+// Over budget it gives up MSAA first, then resolution; with enough headroom it restores
+// resolution first, then MSAA. Changes wait for the average to settle so the image does not pump.
+class DynamicResolution
+{
+public:
+	// Frame time to stay under, in milliseconds
+	float budgetMs = 33.3f;
+	// Lowest fraction of the window resolution to render at
+	float minScale = 0.5f;
+	// Sample count used when there is room for it
+	int maxSamples = 4;
+	// When false the scale stays at 1 and MSAA at maxSamples
+	bool enabled = true;
+
+	// Feeds the time of the last frame and adjusts the scale and sample count
+	void Update(float frameMs);
+
+	float Scale() const { return enabled ? scale : 1.0f; }
+	int Samples() const { return enabled ? samples : maxSamples; }
+	float AverageMs() const { return averageMs; }
+
+private:
+	float scale = 1.0f;
+	int samples = 4;
+	float averageMs = 0.0f;
+	int framesSinceChange = 0;
+};
+
+#endif
\ No newline at end of file
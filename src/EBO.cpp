@@ -1,11 +1,36 @@
 #include"EBO.h"
 
 // Constructor that generates a Elements Buffer Object and links it to indices
-EBO::EBO(GLuint* indices, GLsizeiptr size)
+EBO::EBO(GLuint* indices, GLsizeiptr size, GLenum usage)
 {
 	glGenBuffers(1, &ID);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, usage);
+}
+
+// Deletes the EBO when the wrapper goes out of scope
+EBO::~EBO()
+{
+	Delete();
+}
+
+// Takes over the buffer of another EBO, leaving it empty
+EBO::EBO(EBO&& other) noexcept
+	: ID(other.ID)
+{
+	other.ID = 0;
+}
+
+// Releases the current buffer and takes over the buffer of another EBO
+EBO& EBO::operator=(EBO&& other) noexcept
+{
+	if (this != &other)
+	{
+		Delete();
+		ID = other.ID;
+		other.ID = 0;
+	}
+	return *this;
 }
 
 // Binds the EBO
@@ -23,5 +48,9 @@ void EBO::Unbind()
 // Deletes the EBO
 void EBO::Delete()
 {
-	glDeleteBuffers(1, &ID);
+	if (ID != 0)
+	{
+		glDeleteBuffers(1, &ID);
+		ID = 0;
+	}
 }
\ No newline at end of file
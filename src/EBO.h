@@ -7,9 +7,17 @@ class EBO
 {
 public:
 	// ID reference of Elements Buffer Object
-	GLuint ID;
+	GLuint ID = 0;
 	// Constructor that generates a Elements Buffer Object and links it to indices
-	EBO(GLuint* indices, GLsizeiptr size);
+	EBO(GLuint* indices, GLsizeiptr size, GLenum usage = GL_STATIC_DRAW);
+	// Deletes the EBO when the wrapper goes out of scope
+	~EBO();
+
+	// An EBO owns its GL buffer, so it can be moved but never copied
+	EBO(const EBO&) = delete;
+	EBO& operator=(const EBO&) = delete;
+	EBO(EBO&& other) noexcept;
+	EBO& operator=(EBO&& other) noexcept;
 
 	// Binds the EBO
 	void Bind();
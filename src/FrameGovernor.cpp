@@ -0,0 +1,106 @@
+#include"FrameGovernor.h"
+
+#include<algorithm>
+#include<cmath>
+
+namespace
+{
+	// Frames to wait after a change so the averages reflect the new settings
+	const int settleFrames = 20;
+	// Weight of the newest frame in the moving averages
+	const float smoothing = 0.15f;
+	// Physics has to fit in the budget with this margin before accuracy goes back up
+	const float raiseBelow = 0.7f;
+	const float lowerAbove = 1.0f;
+	// Rebuilding the octree less often is the cheapest saving when it is at least this share of physics
+	const float rebuildShare = 0.25f;
+	const float thetaStep = 0.1f;
+
+	float blend(float average, float sample)
+	{
+		return average + (sample - average) * smoothing;
+	}
+}
+
+// Feeds the timings of the last simulated frame and adjusts the knobs in place
+void FrameGovernor::Update(const PhaseTimings& timings, float& theta, int& stepsPerOctreeRebuild, int& stepsPerVisualFrame)
+{
+	if (!haveAverage)
+	{
+		average = timings;
+		haveAverage = true;
+	}
+	else
+	{
+		average.frameMs = blend(average.frameMs, timings.frameMs);
+		average.ticks = blend(average.ticks, timings.ticks);
+		average.octreeBuildMs = blend(average.octreeBuildMs, timings.octreeBuildMs);
+		average.forceMs = blend(average.forceMs, timings.forceMs);
+		average.updateMs = blend(average.updateMs, timings.updateMs);
+	}
+
+	// The octree is rebuilt once every stepsPerOctreeRebuild ticks and every tick runs stepsPerVisualFrame substeps
+	float rebuildMs = average.ticks * average.octreeBuildMs / std::max(stepsPerOctreeRebuild, 1);
+	float stepsMs = average.ticks * stepsPerVisualFrame * (average.forceMs + average.updateMs);
+	physicsMs = rebuildMs + stepsMs;
+	// Rendering and the UI are not ours to change, whatever they leave of the target is the physics budget
+	float otherMs = std::max(average.frameMs - physicsMs, 0.0f);
+	physicsBudgetMs = std::max(targetFrameMs - otherMs, 0.0f);
+
+	if (!enabled || ++framesSinceChange < settleFrames || physicsMs <= 0.0f)
+	{
+		return;
+	}
+
+	if (physicsMs > physicsBudgetMs * lowerAbove)
+	{
+		float ratio = physicsBudgetMs / physicsMs;
+		if (rebuildMs > physicsMs * rebuildShare && stepsPerOctreeRebuild < maxStepsPerOctreeRebuild)
+		{
+			stepsPerOctreeRebuild = std::min(maxStepsPerOctreeRebuild, stepsPerOctreeRebuild + std::max(1, stepsPerOctreeRebuild / 2));
+			lastAction = "rebuilding the octree less often";
+		}
+		else if (stepsPerVisualFrame > minStepsPerVisualFrame)
+		{
+			// Substeps scale the cost linearly, so jump straight to the count that fits
+			int fitting = static_cast<int>(std::floor(stepsPerVisualFrame * ratio));
+			stepsPerVisualFrame = std::clamp(fitting, minStepsPerVisualFrame, stepsPerVisualFrame - 1);
+			lastAction = "fewer substeps";
+		}
+		else if (theta < maxTheta)
+		{
+			theta = std::min(maxTheta, theta + thetaStep);
+			lastAction = "wider opening angle";
+		}
+		else
+		{
+			lastAction = "at minimum accuracy";
+			return;
+		}
+		framesSinceChange = 0;
+	}
+	else if (physicsMs < physicsBudgetMs * raiseBelow)
+	{
+		if (theta > minTheta)
+		{
+			theta = std::max(minTheta, theta - thetaStep);
+			lastAction = "narrower opening angle";
+		}
+		else if (stepsPerOctreeRebuild > 1)
+		{
+			stepsPerOctreeRebuild--;
+			lastAction = "rebuilding the octree more often";
+		}
+		else if (stepsPerVisualFrame < maxStepsPerVisualFrame)
+		{
+			stepsPerVisualFrame++;
+			lastAction = "more substeps";
+		}
+		else
+		{
+			lastAction = "at maximum accuracy";
+			return;
+		}
+		framesSinceChange = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef FRAME_GOVERNOR_CLASS_H
+#define FRAME_GOVERNOR_CLASS_H
+
+// Measured cost of the last frame, in milliseconds
+struct PhaseTimings
+{
+	float frameMs;
+	// physics ticks run per frame on average, each one running stepsPerVisualFrame substeps
+	float ticks;
+	// one octree rebuild
+	float octreeBuildMs;
+	// one force pass and one integration pass, i.e. one physics substep
+	float forceMs;
+	float updateMs;
+};
+
+// Adjusts the simulation quality knobs every frame so the frame time stays near a target without
+// dropping below a minimum accuracy. The physics budget is the target minus whatever the frame spends
+// outside physics; when physics does not fit, the knob that buys the most time for the least accuracy
+// is turned first, and when there is headroom accuracy is restored in the opposite order.
+class FrameGovernor
+{
+public:
+	bool enabled = false;
+	float targetFrameMs = 33.3f;
+
+	// Minimum accuracy: the governor never goes past these
+	float maxTheta = 1.2f;
+	int minStepsPerVisualFrame = 1;
+	int maxStepsPerOctreeRebuild = 20;
+
+	// How far accuracy is raised when there is headroom
+	float minTheta = 0.5f;
+	int maxStepsPerVisualFrame = 20;
+
+	// Feeds the timings of the last simulated frame and adjusts the knobs in place
+	void Update(const PhaseTimings& timings, float& theta, int& stepsPerOctreeRebuild, int& stepsPerVisualFrame);
+
+	// Short description of the last adjustment, for the UI
+	const char* LastAction() const { return lastAction; }
+	// Predicted physics time per frame and the time left for it, from the smoothed timings
+	float PhysicsMs() const { return physicsMs; }
+	float PhysicsBudgetMs() const { return physicsBudgetMs; }
+
+private:
+	PhaseTimings average = {};
+	bool haveAverage = false;
+	int framesSinceChange = 0;
+	float physicsMs = 0.0f;
+	float physicsBudgetMs = 0.0f;
+	const char* lastAction = "none";
+};
+
+#endif
\ No newline at end of file
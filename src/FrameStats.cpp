@@ -0,0 +1,99 @@
+#include"FrameStats.h"
+
+#include<algorithm>
+#include<cstring>
+
+// Keeps history frames of every phase
+FrameStats::FrameStats(size_t history)
+	: history(std::max<size_t>(history, 1))
+{
+}
+
+// Adds ms to a phase of the current frame
+void FrameStats::Add(const char* phase, float ms)
+{
+	for (Phase& existing : phases)
+	{
+		if (existing.name == phase || std::strcmp(existing.name, phase) == 0)
+		{
+			existing.current += ms;
+			return;
+		}
+	}
+	// a phase seen for the first time has been zero in every earlier frame
+	phases.push_back({ phase, std::vector<float>(history, 0.0f), ms });
+}
+
+// Closes the current frame and appends one sample per phase
+void FrameStats::EndFrame()
+{
+	size_t slot = frames % history;
+	for (Phase& phase : phases)
+	{
+		phase.samples[slot] = phase.current;
+		phase.current = 0.0f;
+	}
+	frames++;
+}
+
+// Throws the current frame away
+void FrameStats::DiscardFrame()
+{
+	for (Phase& phase : phases)
+	{
+		phase.current = 0.0f;
+	}
+}
+
+// Forgets every sample
+void FrameStats::Reset()
+{
+	frames = 0;
+	for (Phase& phase : phases)
+	{
+		std::fill(phase.samples.begin(), phase.samples.end(), 0.0f);
+		phase.current = 0.0f;
+	}
+}
+
+// Min, mean, median, 99th percentile and max of a phase
+PhaseSummary FrameStats::Summary(size_t phase) const
+{
+	PhaseSummary summary = {};
+	size_t count = static_cast<size_t>(Count());
+	if (count == 0)
+	{
+		return summary;
+	}
+	sorted.assign(phases[phase].samples.begin(), phases[phase].samples.begin() + count);
+	std::sort(sorted.begin(), sorted.end());
+	double sum = 0.0;
+	for (float sample : sorted)
+	{
+		sum += sample;
+	}
+	// nearest-rank percentiles
+	auto percentile = [this, count](double fraction) {
+		size_t rank = static_cast<size_t>(fraction * count + 0.999999);
+		return sorted[std::min(std::max<size_t>(rank, 1), count) - 1];
+	};
+	summary.min = sorted.front();
+	summary.mean = static_cast<float>(sum / count);
+	summary.p50 = percentile(0.50);
+	summary.p99 = percentile(0.99);
+	summary.max = sorted.back();
+	return summary;
+}
+
+// Counts the samples of a phase in bins equal slices of [0, maxMs]
+void FrameStats::Histogram(size_t phase, int bins, float maxMs, std::vector<float>& counts) const
+{
+	counts.assign(std::max(bins, 1), 0.0f);
+	int count = Count();
+	for (int i = 0; i < count; i++)
+	{
+		float sample = phases[phase].samples[i];
+		int bin = maxMs > 0.0f ? static_cast<int>(sample / maxMs * counts.size()) : 0;
+		counts[std::clamp(bin, 0, static_cast<int>(counts.size()) - 1)] += 1.0f;
+	}
+}
\ No newline at end of file
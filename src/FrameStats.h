@@ -0,0 +1,65 @@
+#ifndef FRAME_STATS_CLASS_H
+#define FRAME_STATS_CLASS_H
+
+#include<algorithm>
+#include<cstddef>
+#include<vector>
+
+// Distribution of one phase over the kept history, in milliseconds
+struct PhaseSummary
+{
+	float min;
+	float mean;
+	float p50;
+	float p99;
+	float max;
+};
+
+// Keeps the last few hundred frames of every phase so spikes and tail latency stay visible after the
+// frame that had them. Phases are added by name during a frame and become one sample each at EndFrame;
+// a phase that did not run in a frame counts as zero for it, so a rare octree rebuild shows up as p99.
+class FrameStats
+{
+public:
+	// Keeps history frames of every phase
+	explicit FrameStats(size_t history = 600);
+
+	// Adds ms to a phase of the current frame; a phase added several times in a frame is summed
+	void Add(const char* phase, float ms);
+	// Closes the current frame and appends one sample per phase
+	void EndFrame();
+	// Throws the current frame away, e.g. one that slept waiting for input
+	void DiscardFrame();
+	// Forgets every sample
+	void Reset();
+
+	// Phases in the order they were first added
+	size_t PhaseCount() const { return phases.size(); }
+	const char* PhaseName(size_t phase) const { return phases[phase].name; }
+	// Samples of a phase as a ring: Count values starting at Offset and wrapping around, as ImGui's plots take them
+	const float* Samples(size_t phase) const { return phases[phase].samples.data(); }
+	int Count() const { return static_cast<int>(std::min(frames, history)); }
+	int Offset() const { return frames < history ? 0 : static_cast<int>(frames % history); }
+	// Frames recorded since the last reset
+	size_t Frames() const { return frames; }
+
+	// Min, mean, median, 99th percentile and max of a phase
+	PhaseSummary Summary(size_t phase) const;
+	// Counts the samples of a phase in bins equal slices of [0, maxMs]; anything longer goes in the last bin
+	void Histogram(size_t phase, int bins, float maxMs, std::vector<float>& counts) const;
+
+private:
+	struct Phase
+	{
+		const char* name;
+		std::vector<float> samples;
+		float current;
+	};
+
+	size_t history;
+	size_t frames = 0;
+	std::vector<Phase> phases;
+	mutable std::vector<float> sorted; // scratch for the percentiles
+};
+
+#endif
\ No newline at end of file
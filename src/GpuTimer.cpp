@@ -0,0 +1,103 @@
+#include"GpuTimer.h"
+
+#include<algorithm>
+
+#include"Tracer.h"
+
+// Keeps latency frames of queries in flight
+GpuTimer::GpuTimer(int latency)
+	: frames(std::max(latency, 2))
+{
+}
+
+// Deletes the queries
+GpuTimer::~GpuTimer()
+{
+	Delete();
+}
+
+// Starts a frame and picks up the results of the oldest one in flight
+void GpuTimer::BeginFrame()
+{
+	End();
+	current = (current + 1) % frames.size();
+	Frame& frame = frames[current];
+	// This frame's queries are about to be reused; their results are read now or never
+	if (frame.used > 0 && !Collect(frame))
+	{
+		dropped++;
+	}
+	frame.used = 0;
+}
+
+// Starts timing a pass
+void GpuTimer::Begin(const char* name)
+{
+	End();
+	Frame& frame = frames[current];
+	if (frame.used == static_cast<int>(frame.queries.size()))
+	{
+		GLuint query;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+		frame.names.push_back(nullptr);
+		frame.cpuMs.push_back(0.0f);
+	}
+	frame.names[frame.used] = name;
+	glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.used]);
+	openStart = Tracer::Now();
+	open = true;
+}
+
+// Stops timing the open pass
+void GpuTimer::End()
+{
+	if (!open)
+	{
+		return;
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	Frame& frame = frames[current];
+	frame.cpuMs[frame.used] = (Tracer::Now() - openStart) * 1e-6f;
+	frame.used++;
+	open = false;
+}
+
+// Copies the results of a finished frame, or returns false if the GPU is still on it
+bool GpuTimer::Collect(Frame& frame)
+{
+	// queries finish in order, so the last one being ready means they all are
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		return false;
+	}
+	results.clear();
+	gpuMs = 0.0f;
+	cpuMs = 0.0f;
+	for (int i = 0; i < frame.used; i++)
+	{
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &nanoseconds);
+		results.push_back({ frame.names[i], frame.cpuMs[i], nanoseconds * 1e-6f });
+		gpuMs += results.back().gpuMs;
+		cpuMs += frame.cpuMs[i];
+	}
+	return true;
+}
+
+// Deletes the queries
+void GpuTimer::Delete()
+{
+	for (Frame& frame : frames)
+	{
+		if (!frame.queries.empty())
+		{
+			glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+		}
+		frame.queries.clear();
+		frame.used = 0;
+	}
+	open = false;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef GPU_TIMER_CLASS_H
+#define GPU_TIMER_CLASS_H
+
+#include<glad/glad.h>
+
+#include<cstddef>
+#include<cstdint>
+#include<vector>
+
+// Time one render pass took on the GPU and on the CPU submitting it, in milliseconds
+struct GpuPassTime
+{
+	const char* name;
+	float cpuMs;
+	float gpuMs;
+};
+
+// Measures render passes with GL_TIME_ELAPSED queries, which GL 3.3 has on every driver. Reading a query
+// right away would wait for the GPU to catch up, so each frame uses its own set of queries and the results
+// are read latency frames later, when the GPU is long done with them. Passes cannot nest: a pass begun
+// while another is open ends the open one.
+class GpuTimer
+{
+public:
+	// Keeps latency frames of queries in flight
+	explicit GpuTimer(int latency = 4);
+	// Deletes the queries
+	~GpuTimer();
+
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	// Starts a frame and picks up the results of the oldest one in flight if the GPU has finished it
+	void BeginFrame();
+	// Starts timing a pass; name must outlive the timer
+	void Begin(const char* name);
+	// Stops timing the open pass
+	void End();
+
+	// Passes of the newest frame with results, in the order they ran
+	const std::vector<GpuPassTime>& Results() const { return results; }
+	// Whether any frame has been measured yet
+	bool Available() const { return !results.empty(); }
+	// Sum of the passes of that frame
+	float GpuMs() const { return gpuMs; }
+	float CpuMs() const { return cpuMs; }
+	// Frames between measuring a pass and showing its result
+	int Latency() const { return static_cast<int>(frames.size()); }
+	// Frames whose results were not ready when their queries had to be reused
+	int Dropped() const { return dropped; }
+
+	// Deletes the queries
+	void Delete();
+
+private:
+	struct Frame
+	{
+		std::vector<GLuint> queries; // grows to the most passes a frame had, then stays
+		std::vector<const char*> names;
+		std::vector<float> cpuMs;
+		int used = 0;
+	};
+
+	// Copies the results of a finished frame, or returns false if the GPU is still on it
+	bool Collect(Frame& frame);
+
+	std::vector<Frame> frames;
+	size_t current = 0;
+	bool open = false;
+	uint64_t openStart = 0;
+	std::vector<GpuPassTime> results;
+	float gpuMs = 0.0f;
+	float cpuMs = 0.0f;
+	int dropped = 0;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,297 @@
+#include"InitialConditions.h"
+
+#include<algorithm>
+#include<cmath>
+#include<vector>
+
+const char* const generatorModelNames[generatorModelCount] = {
+	"Uniform sphere", "Plummer", "Hernquist", "Exponential disk", "Cold collapse"
+};
+
+namespace
+{
+	const double pi = 3.14159265358979323846;
+
+	// The draws of one body, in order
+	struct BodyRandom
+	{
+		uint64_t seed;
+		uint64_t index;
+		uint32_t draw;
+
+		// Uniform in (0, 1), never exactly 0 or 1
+		double Uniform()
+		{
+			return (static_cast<double>(counterRandom(seed, index, draw++) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+		}
+
+		// Standard normal by Box-Muller
+		double Normal()
+		{
+			double u = Uniform();
+			double v = Uniform();
+			return std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * pi * v);
+		}
+
+		// Uniform on the unit sphere
+		void Direction(double direction[3])
+		{
+			double z = 2.0 * Uniform() - 1.0;
+			double phi = 2.0 * pi * Uniform();
+			double s = std::sqrt(std::max(0.0, 1.0 - z * z));
+			direction[0] = s * std::cos(phi);
+			direction[1] = s * std::sin(phi);
+			direction[2] = z;
+		}
+	};
+
+	// Speed of a circular orbit at radius r around the mass enclosed by it
+	double circularSpeed(double gravity, double enclosedMass, double r)
+	{
+		return r > 0.0 ? std::sqrt(gravity * enclosedMass / r) : 0.0;
+	}
+
+	// Sets velocity to speed along the circle around the z axis through position, counterclockwise seen from +z
+	void rotateAboutZ(const double position[3], double speed, double velocity[3])
+	{
+		double cylindrical = std::sqrt(position[0] * position[0] + position[1] * position[1]);
+		if (cylindrical <= 0.0)
+		{
+			velocity[0] = velocity[1] = velocity[2] = 0.0;
+			return;
+		}
+		velocity[0] = -position[1] / cylindrical * speed;
+		velocity[1] = position[0] / cylindrical * speed;
+		velocity[2] = 0.0;
+	}
+
+	// Isotropic velocity dispersion of a Hernquist sphere (Hernquist 1990, eq. 10)
+	double hernquistDispersion(double gravity, double mass, double a, double r)
+	{
+		double x = r / a;
+		double sigma2 = gravity * mass / (12.0 * a) * (12.0 * x * std::pow(1.0 + x, 3.0) * std::log((1.0 + x) / x)
+			- x / (1.0 + x) * (25.0 + 52.0 * x + 42.0 * x * x + 12.0 * x * x * x));
+		return std::sqrt(std::max(sigma2, 0.0));
+	}
+
+	// Radius of an exponential disk inside which a fraction f of the mass lies, in scale lengths
+	double exponentialDiskRadius(double f)
+	{
+		// Newton on 1 - (1 + x) e^-x = f, whose derivative is x e^-x
+		double x = -std::log(1.0 - f) + 1.0;
+		for (int i = 0; i < 30; i++)
+		{
+			double g = 1.0 - (1.0 + x) * std::exp(-x) - f;
+			double dg = x * std::exp(-x);
+			if (dg <= 0.0)
+			{
+				break;
+			}
+			double step = g / dg;
+			x = std::max(x - step, x * 0.5);
+			if (std::abs(step) < 1e-12 * x)
+			{
+				break;
+			}
+		}
+		return x;
+	}
+
+	// Places one body of a model; every random number it uses comes from random
+	void generateBody(const GeneratorOptions& options, BodyRandom& random, double position[3], double velocity[3])
+	{
+		double a = options.scaleRadius;
+		double M = options.totalMass;
+		double G = options.gravity;
+		double direction[3];
+		velocity[0] = velocity[1] = velocity[2] = 0.0;
+
+		switch (options.model)
+		{
+		case generatorUniformSphere:
+		case generatorColdCollapse:
+		{
+			double r = a * std::cbrt(random.Uniform());
+			random.Direction(direction);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				position[axis] = r * direction[axis];
+			}
+			if (options.model == generatorUniformSphere)
+			{
+				// circular speed about z from the mass inside the body's radius, so the sphere spins without flying apart
+				double cylindrical = std::sqrt(position[0] * position[0] + position[1] * position[1]);
+				double enclosed = M * std::pow(r / a, 3.0);
+				rotateAboutZ(position, circularSpeed(G, enclosed, r) * (r > 0.0 ? cylindrical / r : 0.0), velocity);
+			}
+			break;
+		}
+		case generatorPlummer:
+		{
+			// Aarseth, Henon and Wielen (1974); the mass fraction is capped so no body starts beyond 20 scale lengths
+			double fraction = random.Uniform() * 0.9996;
+			double r = a / std::sqrt(std::pow(fraction, -2.0 / 3.0) - 1.0);
+			random.Direction(direction);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				position[axis] = r * direction[axis];
+			}
+			// q = v / v_escape from g(q) = q^2 (1 - q^2)^3.5 by rejection; 0.1 bounds g
+			double q = 0.0;
+			for (int attempt = 0; attempt < 1000; attempt++)
+			{
+				q = random.Uniform();
+				if (0.1 * random.Uniform() < q * q * std::pow(1.0 - q * q, 3.5))
+				{
+					break;
+				}
+			}
+			double escape = std::sqrt(2.0 * G * M) * std::pow(r * r + a * a, -0.25);
+			random.Direction(direction);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				velocity[axis] = q * escape * direction[axis];
+			}
+			break;
+		}
+		case generatorHernquist:
+		{
+			// M(<r) = M r^2 / (r + a)^2 inverts in closed form; the cap keeps bodies within 100 scale lengths
+			double s = std::sqrt(random.Uniform() * 0.98);
+			double r = a * s / (1.0 - s);
+			random.Direction(direction);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				position[axis] = r * direction[axis];
+			}
+			double sigma = hernquistDispersion(G, M, a, r);
+			double escape = std::sqrt(2.0 * G * M / (r + a));
+			double speed2 = 0.0;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				velocity[axis] = sigma * random.Normal();
+				speed2 += velocity[axis] * velocity[axis];
+			}
+			// the Gaussian tail would leave the cluster; slow those bodies to just bound
+			if (speed2 > 0.9 * escape * escape)
+			{
+				double scale = std::sqrt(0.9 * escape * escape / speed2);
+				for (int axis = 0; axis < 3; axis++)
+				{
+					velocity[axis] *= scale;
+				}
+			}
+			break;
+		}
+		case generatorExponentialDisk:
+		default:
+		{
+			// Surface density ~ exp(-R / a) out to 10 scale lengths, sech^2 profile a tenth of a scale length thick
+			double fraction = random.Uniform() * (1.0 - 11.0 * std::exp(-10.0));
+			double R = a * exponentialDiskRadius(fraction);
+			double phi = 2.0 * pi * random.Uniform();
+			double height = 0.1 * a;
+			position[0] = R * std::cos(phi);
+			position[1] = R * std::sin(phi);
+			position[2] = height * std::atanh(2.0 * random.Uniform() - 1.0);
+			// the enclosed mass treated as spherical, a close enough speed for a cold disk
+			double enclosed = M * fraction;
+			rotateAboutZ(position, circularSpeed(G, enclosed, R), velocity);
+			// a few percent of random motion keeps the disk from starting perfectly cold
+			double dispersion = 0.05 * circularSpeed(G, enclosed, R);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				velocity[axis] += dispersion * random.Normal() * (axis == 2 ? 0.5 : 1.0);
+			}
+			break;
+		}
+		}
+	}
+}
+
+// Random 64 bits for one body: a hash of the seed, the body's index and which of its draws this is
+uint64_t counterRandom(uint64_t seed, uint64_t index, uint32_t draw)
+{
+	// SplitMix64's finalizer applied twice over the three keys; no state is shared between bodies
+	uint64_t x = seed * 0x9E3779B97F4A7C15ULL ^ (index + 0x632BE59BD9B4E019ULL);
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	x ^= x >> 31;
+	x += (static_cast<uint64_t>(draw) + 1) * 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+// Fills out with a model, one body per iteration of a parallel loop
+void generateInitialConditions(const GeneratorOptions& options, SnapshotData& out, std::atomic<float>* progress)
+{
+	size_t count = options.count;
+	out.simulationTime = 0.0;
+	out.positions.resize(count * 3);
+	out.velocities.resize(count * 3);
+	out.masses.resize(count);
+	out.radii.clear();
+	out.colors.clear();
+	out.meshIds.clear();
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Bodies are generated in blocks, each finished block adding to the progress
+	double bodyMass = options.totalMass / static_cast<double>(count);
+	const size_t block = 65536;
+	size_t blocks = (count + block - 1) / block;
+	std::atomic<size_t> blocksDone{ 0 };
+	#pragma omp parallel for schedule(dynamic)
+	for (long long b = 0; b < static_cast<long long>(blocks); b++)
+	{
+		size_t end = std::min(count, static_cast<size_t>(b + 1) * block);
+		for (size_t i = static_cast<size_t>(b) * block; i < end; i++)
+		{
+			BodyRandom random = { options.seed, i, 0 };
+			generateBody(options, random, &out.positions[3 * i], &out.velocities[3 * i]);
+			out.masses[i] = bodyMass;
+		}
+		if (progress != nullptr)
+		{
+			progress->store(static_cast<float>(++blocksDone) / static_cast<float>(blocks), std::memory_order_relaxed);
+		}
+	}
+
+	// Shift to the center of mass frame, so finite sampling does not make the model drift. The sums run over
+	// fixed blocks added in order, so rounding and with it the result do not depend on the thread count.
+	std::vector<double> blockSums(blocks * 6, 0.0);
+	#pragma omp parallel for
+	for (long long b = 0; b < static_cast<long long>(blocks); b++)
+	{
+		double* sum = &blockSums[6 * b];
+		size_t end = std::min(count, static_cast<size_t>(b + 1) * block);
+		for (size_t i = static_cast<size_t>(b) * block; i < end; i++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				sum[axis] += out.positions[3 * i + axis];
+				sum[3 + axis] += out.velocities[3 * i + axis];
+			}
+		}
+	}
+	double center[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	for (size_t b = 0; b < blocks; b++)
+	{
+		for (int j = 0; j < 6; j++)
+		{
+			center[j] += blockSums[6 * b + j];
+		}
+	}
+	#pragma omp parallel for
+	for (long long k = 0; k < static_cast<long long>(count); k++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			out.positions[3 * k + axis] -= center[axis] / static_cast<double>(count);
+			out.velocities[3 * k + axis] -= center[3 + axis] / static_cast<double>(count);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef INITIAL_CONDITIONS_CLASS_H
+#define INITIAL_CONDITIONS_CLASS_H
+
+#include<atomic>
+#include<cstddef>
+#include<cstdint>
+
+#include"Snapshot.h"
+
+enum GeneratorModel
+{
+	generatorUniformSphere, // rotating sphere of constant density
+	generatorPlummer,       // Plummer sphere in equilibrium
+	generatorHernquist,     // Hernquist bulge with isotropic Jeans velocities
+	generatorExponentialDisk, // thin disk on circular orbits
+	generatorColdCollapse,  // uniform sphere at rest
+	generatorModelCount
+};
+
+// Names of the models for menus, in the order of GeneratorModel
+extern const char* const generatorModelNames[generatorModelCount];
+
+struct GeneratorOptions
+{
+	GeneratorModel model = generatorPlummer;
+	size_t count = 10000;
+	uint64_t seed = 1;
+	double scaleRadius = 150.0; // Mm; the sphere radius, Plummer or Hernquist scale length, or disk scale length
+	double totalMass = 1e3;     // Rg, split evenly between the bodies
+	double gravity = 1.0;       // G in the units of the simulation
+};
+
+// Fills the position, velocity and mass columns of out with a model centered on the origin, every core
+// working on its own bodies. Each body draws its random numbers from a counter-based generator keyed
+// by the seed and its index, so the same options give the same bodies whatever the number of threads.
+// The finished fraction goes to progress if it is not null.
+void generateInitialConditions(const GeneratorOptions& options, SnapshotData& out, std::atomic<float>* progress = nullptr);
+
+// Random 64 bits for one body: a hash of the seed, the body's index and which of its draws this is
+uint64_t counterRandom(uint64_t seed, uint64_t index, uint32_t draw);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include"JobSystem.h"
+
+#include<algorithm>
+
+#include"Tracer.h"
+
+// Starts the worker threads
+JobSystem::JobSystem(unsigned threads)
+{
+	for (unsigned i = 0; i < std::max(threads, 1u); i++)
+	{
+		workers.emplace_back(&JobSystem::WorkerLoop, this);
+	}
+}
+
+// Cancels the jobs, waits for the running ones and stops the threads
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		for (const std::shared_ptr<Job>& job : jobs)
+		{
+			job->progress.Cancel();
+		}
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+// Queues a job and returns its id
+uint64_t JobSystem::Submit(const std::string& name, std::function<bool(JobProgress&)> work, std::function<void()> commit)
+{
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->name = name;
+	job->work = std::move(work);
+	job->commit = std::move(commit);
+	job->started = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job->id = nextId++;
+		jobs.push_back(job);
+		queue.push_back(job);
+	}
+	wake.notify_one();
+	return job->id;
+}
+
+// Runs the commits of finished jobs from the oldest on, stopping at the first one still working
+void JobSystem::CommitFinished()
+{
+	while (true)
+	{
+		std::shared_ptr<Job> job;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (jobs.empty() || jobs.front()->state != jobFinished)
+			{
+				return;
+			}
+			job = jobs.front();
+			jobs.pop_front();
+		}
+		// outside the lock, so a commit may submit new jobs
+		if (job->succeeded && !job->progress.Cancelled() && job->commit)
+		{
+			job->commit();
+		}
+	}
+}
+
+// Asks a job to stop; a queued job is dropped without running
+void JobSystem::Cancel(uint64_t id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const std::shared_ptr<Job>& job : jobs)
+	{
+		if (job->id == id)
+		{
+			job->progress.Cancel();
+		}
+	}
+}
+
+// Every job that has not been committed yet, in submission order
+std::vector<JobInfo> JobSystem::Jobs() const
+{
+	std::vector<JobInfo> infos;
+	std::lock_guard<std::mutex> lock(mutex);
+	auto now = std::chrono::steady_clock::now();
+	for (const std::shared_ptr<Job>& job : jobs)
+	{
+		infos.push_back({ job->id, job->name, job->progress.Get(), job->state == jobFinished,
+			std::chrono::duration<float>(now - job->started).count() });
+	}
+	return infos;
+}
+
+// Whether any job is waiting, running or waiting to be committed
+bool JobSystem::Busy() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return !jobs.empty();
+}
+
+// Runs queued jobs until the system is destroyed
+void JobSystem::WorkerLoop()
+{
+	Tracer::NameThread("Job worker");
+	while (true)
+	{
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !queue.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+			job = queue.front();
+			queue.pop_front();
+			job->state = jobRunning;
+		}
+
+		TraceZone zone(Tracer::Intern(job->name));
+		bool succeeded = !job->progress.Cancelled() && job->work(job->progress);
+		zone.End();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		job->succeeded = succeeded;
+		job->state = jobFinished;
+		job->work = nullptr; // frees whatever the work captured
+	}
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#ifndef JOB_SYSTEM_CLASS_H
+#define JOB_SYSTEM_CLASS_H
+
+#include<atomic>
+#include<chrono>
+#include<condition_variable>
+#include<cstdint>
+#include<deque>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<thread>
+#include<vector>
+
+// Shared between a running job and the UI: how far along it is and whether it should give up
+class JobProgress
+{
+public:
+	// Sets the finished fraction, from 0 to 1
+	void Set(float fraction) { value.store(fraction, std::memory_order_relaxed); }
+	float Get() const { return value.load(std::memory_order_relaxed); }
+	// Asks the job to stop; its result is thrown away even if it finishes anyway
+	void Cancel() { cancelled.store(true, std::memory_order_relaxed); }
+	bool Cancelled() const { return cancelled.load(std::memory_order_relaxed); }
+	// The fraction as a pointer for code that reports progress without knowing about jobs
+	std::atomic<float>* Fraction() { return &value; }
+
+private:
+	std::atomic<float> value{ 0.0f };
+	std::atomic<bool> cancelled{ false };
+};
+
+// What the UI shows about one job
+struct JobInfo
+{
+	uint64_t id;
+	std::string name;
+	float progress;
+	bool finished;
+	float seconds;
+};
+
+// Runs heavy work that the UI asks for on a few worker threads, so a click never stalls a frame.
+// A job has two parts: work, which runs on a worker and must not touch the simulation, and commit,
+// which the main thread runs from CommitFinished at a frame boundary once work returned true.
+// Commits run in the order the jobs were submitted, so a later job's result always wins.
+class JobSystem
+{
+public:
+	// Starts the worker threads
+	explicit JobSystem(unsigned threads = 2);
+	// Cancels the jobs, waits for the running ones and stops the threads
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Queues a job and returns its id
+	uint64_t Submit(const std::string& name, std::function<bool(JobProgress&)> work, std::function<void()> commit);
+	// Runs the commits of finished jobs; call once per frame from the main thread
+	void CommitFinished();
+	// Asks a job to stop
+	void Cancel(uint64_t id);
+	// Every job that has not been committed yet, in submission order
+	std::vector<JobInfo> Jobs() const;
+	// Whether any job is waiting, running or waiting to be committed
+	bool Busy() const;
+
+private:
+	enum JobState
+	{
+		jobQueued,
+		jobRunning,
+		jobFinished
+	};
+
+	struct Job
+	{
+		uint64_t id;
+		std::string name;
+		std::function<bool(JobProgress&)> work;
+		std::function<void()> commit;
+		JobProgress progress;
+		JobState state = jobQueued;
+		bool succeeded = false;
+		std::chrono::steady_clock::time_point started;
+	};
+
+	// Runs queued jobs until the system is destroyed
+	void WorkerLoop();
+
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<std::shared_ptr<Job>> jobs;  // submitted and not yet committed, oldest first
+	std::deque<std::shared_ptr<Job>> queue; // waiting for a worker
+	uint64_t nextId = 1;
+	bool stopping = false;
+	std::vector<std::thread> workers;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include"MappedFile.h"
+
+#include<utility>
+
+#ifdef _WIN32
+#include<windows.h>
+#else
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif
+
+// Maps the file at path; Valid() is false if it could not be opened or mapped
+MappedFile::MappedFile(const char* path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return;
+	}
+	fileHandle = file;
+	size = static_cast<size_t>(fileSize.QuadPart);
+	if (size == 0)
+	{
+		// Empty files cannot be mapped but are still valid
+		valid = true;
+		return;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		Close();
+		return;
+	}
+	mappingHandle = mapping;
+	data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr)
+	{
+		Close();
+		return;
+	}
+	valid = true;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		close(fd);
+		return;
+	}
+	size = static_cast<size_t>(info.st_size);
+	if (size == 0)
+	{
+		// Empty files cannot be mapped but are still valid
+		close(fd);
+		valid = true;
+		return;
+	}
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps its own reference to the file
+	close(fd);
+	if (mapping == MAP_FAILED)
+	{
+		size = 0;
+		return;
+	}
+	data = static_cast<const char*>(mapping);
+	valid = true;
+#endif
+}
+
+// Unmaps the file when the wrapper goes out of scope
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+// Takes over the mapping of another MappedFile, leaving it empty
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: data(other.data), size(other.size), valid(other.valid)
+#ifdef _WIN32
+	, fileHandle(other.fileHandle), mappingHandle(other.mappingHandle)
+#endif
+{
+	other.data = nullptr;
+	other.size = 0;
+	other.valid = false;
+#ifdef _WIN32
+	other.fileHandle = nullptr;
+	other.mappingHandle = nullptr;
+#endif
+}
+
+// Unmaps the current file and takes over the mapping of another MappedFile
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		std::swap(data, other.data);
+		std::swap(size, other.size);
+		std::swap(valid, other.valid);
+#ifdef _WIN32
+		std::swap(fileHandle, other.fileHandle);
+		std::swap(mappingHandle, other.mappingHandle);
+#endif
+	}
+	return *this;
+}
+
+// Unmaps the file
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+		mappingHandle = nullptr;
+	}
+	if (fileHandle != nullptr)
+	{
+		CloseHandle(fileHandle);
+		fileHandle = nullptr;
+	}
+#else
+	if (data != nullptr)
+	{
+		munmap(const_cast<char*>(data), size);
+	}
+#endif
+	data = nullptr;
+	size = 0;
+	valid = false;
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef MAPPED_FILE_CLASS_H
+#define MAPPED_FILE_CLASS_H
+
+#include<cstddef>
+
+// Maps a whole file read-only into memory so it can be parsed in place without copying it
+class MappedFile
+{
+public:
+	// Maps the file at path; Valid() is false if it could not be opened or mapped
+	explicit MappedFile(const char* path);
+	// Unmaps the file when the wrapper goes out of scope
+	~MappedFile();
+
+	// A MappedFile owns its mapping, so it can be moved but never copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool Valid() const { return valid; }
+	const char* Data() const { return data; }
+	size_t Size() const { return size; }
+
+	// Unmaps the file
+	void Close();
+
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+	bool valid = false;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
+#endif
\ No newline at end of file
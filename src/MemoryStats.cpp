@@ -0,0 +1,221 @@
+#include"MemoryStats.h"
+
+#include<atomic>
+#include<cstdlib>
+#include<cstring>
+#include<new>
+
+#ifdef _WIN32
+#include<malloc.h>
+#endif
+
+namespace
+{
+	// Constant-initialized, so allocations made before main are counted too
+	std::atomic<uint64_t> allocationCount{ 0 };
+	std::atomic<uint64_t> allocatedBytes{ 0 };
+
+	std::vector<PhaseAllocations>& phases()
+	{
+		static std::vector<PhaseAllocations> list;
+		return list;
+	}
+
+	void* allocate(std::size_t size)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		return std::malloc(size == 0 ? 1 : size);
+	}
+
+	// Over-aligned types come here; aligned_alloc wants a size that is a multiple of the alignment
+	void* allocateAligned(std::size_t size, std::align_val_t alignment)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		std::size_t bytes = static_cast<std::size_t>(alignment);
+		std::size_t rounded = size == 0 ? bytes : (size + bytes - 1) / bytes * bytes;
+#ifdef _WIN32
+		return _aligned_malloc(rounded, bytes);
+#else
+		return std::aligned_alloc(bytes, rounded);
+#endif
+	}
+
+	void freeAligned(void* memory)
+	{
+#ifdef _WIN32
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+}
+
+// Every form is replaced, aligned ones included, so every heap allocation is counted and whatever the standard
+// library falls back on, each allocation is released by the matching free
+void* operator new(std::size_t size)
+{
+	void* memory = allocate(size);
+	if (memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	std::free(memory);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	void* memory = allocateAligned(size, alignment);
+	if (memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocateAligned(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	freeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	freeAligned(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+	freeAligned(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+	freeAligned(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	freeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	freeAligned(memory);
+}
+
+// Allocations since the program started
+AllocationCount MemoryStats::Allocations()
+{
+	return { allocationCount.load(std::memory_order_relaxed), allocatedBytes.load(std::memory_order_relaxed) };
+}
+
+// Adds a finished zone's allocations to its phase
+void MemoryStats::Add(const char* phase, const AllocationCount& count)
+{
+	for (PhaseAllocations& existing : phases())
+	{
+		if (existing.phase == phase || std::strcmp(existing.phase, phase) == 0)
+		{
+			existing.current.allocations += count.allocations;
+			existing.current.bytes += count.bytes;
+			return;
+		}
+	}
+	phases().push_back({ phase, {}, count });
+}
+
+// Closes the frame
+void MemoryStats::EndFrame()
+{
+	for (PhaseAllocations& phase : phases())
+	{
+		phase.lastFrame = phase.current;
+		phase.current = {};
+	}
+}
+
+// Phases in order of first appearance
+const std::vector<PhaseAllocations>& MemoryStats::Phases()
+{
+	return phases();
+}
+
+// Starts counting towards a phase
+AllocationZone::AllocationZone(const char* phase)
+	: phase(phase), start(MemoryStats::Allocations())
+{
+}
+
+// Closes the zone early and returns its count
+AllocationCount AllocationZone::End()
+{
+	if (open)
+	{
+		open = false;
+		AllocationCount now = MemoryStats::Allocations();
+		count = { now.allocations - start.allocations, now.bytes - start.bytes };
+		MemoryStats::Add(phase, count);
+	}
+	return count;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef MEMORY_STATS_CLASS_H
+#define MEMORY_STATS_CLASS_H
+
+#include<cstddef>
+#include<cstdint>
+#include<vector>
+
+// Heap allocations made with operator new, and the bytes they asked for
+struct AllocationCount
+{
+	uint64_t allocations;
+	uint64_t bytes;
+};
+
+// Allocations of one phase in the last complete frame
+struct PhaseAllocations
+{
+	const char* phase;
+	AllocationCount lastFrame;
+	AllocationCount current; // the frame in progress
+};
+
+// Bytes one part of the program holds on to, used or reserved
+struct MemoryUsage
+{
+	const char* subsystem;
+	size_t bytes;
+};
+
+// Counts every allocation that goes through the global operator new, which this module replaces, on any
+// thread. Counting costs two relaxed atomic adds per allocation. Phases are attributed on the main thread
+// with AllocationZone: a zone counts what every thread allocated while it was open, so worker threads
+// allocating during the force pass show up under the phase that started them.
+class MemoryStats
+{
+public:
+	// Allocations since the program started
+	static AllocationCount Allocations();
+
+	// Adds a finished zone's allocations to its phase; main thread only
+	static void Add(const char* phase, const AllocationCount& count);
+	// Closes the frame: every phase's current count becomes its last frame's count
+	static void EndFrame();
+	// Phases in order of first appearance
+	static const std::vector<PhaseAllocations>& Phases();
+};
+
+// Counts the allocations between its construction and its destruction, or End, towards a phase
+class AllocationZone
+{
+public:
+	explicit AllocationZone(const char* phase);
+	~AllocationZone() { End(); }
+
+	AllocationZone(const AllocationZone&) = delete;
+	AllocationZone& operator=(const AllocationZone&) = delete;
+
+	// Closes the zone early and returns its count; later calls return the same count
+	AllocationCount End();
+
+private:
+	const char* phase;
+	AllocationCount start;
+	AllocationCount count = {};
+	bool open = true;
+};
+
+#endif
\ No newline at end of file
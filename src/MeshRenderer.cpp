@@ -0,0 +1,173 @@
+#include"MeshRenderer.h"
+
+#include<algorithm>
+#include<cstddef>
+#include<utility>
+
+// Uses the shared buffers of meshes and adds the per-instance attributes to its layout
+MeshRenderer::MeshRenderer(BufferManager& meshes, GLuint positionScaleLayout, GLuint colorLayout)
+	: meshes(meshes),
+	  instanceBuffer(nullptr, 0, GL_STREAM_DRAW),
+	  indirectBuffer(nullptr, 0, GL_STREAM_DRAW)
+{
+	indirectBuffer.Unbind();
+	meshes.LinkInstanceAttrib(instanceBuffer, positionScaleLayout, 4, GL_FLOAT, sizeof(InstanceData), offsetof(InstanceData, position));
+	meshes.LinkInstanceAttrib(instanceBuffer, colorLayout, 3, GL_FLOAT, sizeof(InstanceData), offsetof(InstanceData, color));
+}
+
+// Takes ownership of a mesh from the shared buffers and returns the id to draw it with
+GLuint MeshRenderer::AddMesh(Mesh mesh)
+{
+	meshList.push_back(std::move(mesh));
+	return static_cast<GLuint>(meshList.size() - 1);
+}
+
+// Forgets the queued instances; until Clear is called again Draw keeps drawing the same ones
+void MeshRenderer::Clear()
+{
+	instancesDirty = true;
+	// clear() keeps the capacity, so a steady scene stops allocating after the first frames
+	for (Batch& batch : batches)
+	{
+		batch.instances.clear();
+	}
+}
+
+// Queues one instance of a mesh for the next Draw, optionally textured with a GL texture
+void MeshRenderer::AddInstance(GLuint meshId, const InstanceData& instance, GLuint texture)
+{
+	uint64_t key = (static_cast<uint64_t>(texture) << 32) | meshId;
+	auto found = batchLookup.find(key);
+	if (found == batchLookup.end())
+	{
+		found = batchLookup.emplace(key, batches.size()).first;
+		batches.push_back({ meshId, texture, {} });
+		batchOrder.push_back(found->second);
+		std::sort(batchOrder.begin(), batchOrder.end(), [this](size_t a, size_t b) {
+			return batches[a].texture != batches[b].texture ? batches[a].texture < batches[b].texture : batches[a].meshId < batches[b].meshId;
+		});
+	}
+	batches[found->second].instances.push_back(instance);
+	instancesDirty = true;
+}
+
+// Uploads the queued instances if they changed and draws them; the shader must be active
+void MeshRenderer::Draw(Shader& shader)
+{
+	if (instancesDirty)
+	{
+		// Pack the instances batch by batch and build one command per batch that has any
+		instanceData.clear();
+		commands.clear();
+		commandTextures.clear();
+		for (size_t batchIndex : batchOrder)
+		{
+			const Batch& batch = batches[batchIndex];
+			const std::vector<InstanceData>& instances = batch.instances;
+			if (instances.empty())
+			{
+				continue;
+			}
+			const MeshRange& range = meshList[batch.meshId].Range();
+			DrawElementsIndirectCommand command;
+			command.count = static_cast<GLuint>(range.indexCount);
+			command.instanceCount = static_cast<GLuint>(instances.size());
+			command.firstIndex = range.firstIndex;
+			command.baseVertex = range.baseVertex;
+			command.baseInstance = static_cast<GLuint>(instanceData.size());
+			commands.push_back(command);
+			commandTextures.push_back(batch.texture);
+			instanceData.insert(instanceData.end(), instances.begin(), instances.end());
+		}
+
+		if (!instanceData.empty())
+		{
+			instanceBuffer.Bind();
+			glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(InstanceData), instanceData.data(), GL_STREAM_DRAW);
+			instanceBuffer.Unbind();
+		}
+		instancesDirty = false;
+		commandsUploaded = false;
+	}
+
+	drawCalls = 0;
+	if (commands.empty())
+	{
+		return;
+	}
+
+	meshes.Bind();
+	bool indirect = useIndirect && SupportsIndirect();
+	if (indirect)
+	{
+		// baseInstance offsets the instanced attributes, so the pointers stay at the start of the buffer
+		meshes.SetFirstInstance(0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer.ID);
+		if (!commandsUploaded)
+		{
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+			commandsUploaded = true;
+		}
+	}
+
+	// Commands are sorted by texture; each run of equal textures is one multi-draw
+	glActiveTexture(GL_TEXTURE0);
+	size_t first = 0;
+	while (first < commands.size())
+	{
+		GLuint texture = commandTextures[first];
+		size_t last = first + 1;
+		while (last < commands.size() && commandTextures[last] == texture)
+		{
+			last++;
+		}
+		shader.setBool("useTexture", texture != 0);
+		glBindTexture(GL_TEXTURE_2D, texture);
+
+		if (indirect)
+		{
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(first * sizeof(DrawElementsIndirectCommand)),
+				static_cast<GLsizei>(last - first), 0);
+			drawCalls++;
+		}
+		else
+		{
+			for (size_t i = first; i < last; i++)
+			{
+				const DrawElementsIndirectCommand& command = commands[i];
+				meshes.SetFirstInstance(command.baseInstance);
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+					(void*)(static_cast<GLintptr>(command.firstIndex) * sizeof(GLuint)), command.instanceCount, command.baseVertex);
+				drawCalls++;
+			}
+		}
+		first = last;
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (indirect)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	meshes.Unbind();
+}
+
+// Bytes of CPU-side instance and command data, including the room kept between frames
+size_t MeshRenderer::MemoryBytes() const
+{
+	size_t bytes = instanceData.capacity() * sizeof(InstanceData)
+		+ commands.capacity() * sizeof(DrawElementsIndirectCommand)
+		+ commandTextures.capacity() * sizeof(GLuint)
+		+ batchOrder.capacity() * sizeof(size_t);
+	for (const Batch& batch : batches)
+	{
+		bytes += sizeof(Batch) + batch.instances.capacity() * sizeof(InstanceData);
+	}
+	return bytes;
+}
+
+// Whether the context can use the multi-draw indirect path
+bool MeshRenderer::SupportsIndirect() const
+{
+	return GLAD_GL_VERSION_4_3 != 0;
+}
\ No newline at end of file
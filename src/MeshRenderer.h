@@ -0,0 +1,93 @@
+#ifndef MESH_RENDERER_CLASS_H
+#define MESH_RENDERER_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<cstdint>
+#include<unordered_map>
+#include<vector>
+
+#include"BufferManager.h"
+#include"shaderClass.h"
+
+// Per-instance data streamed to the GPU every frame
+struct InstanceData
+{
+	glm::vec3 position;
+	float scale;
+	glm::vec3 color;
+};
+
+// Draws every instance of every registered mesh with a constant number of draw calls.
+// On GL 4.3+ all meshes sharing a texture are submitted with one glMultiDrawElementsIndirect
+// from a command buffer built on the CPU; on a 3.3 context each mesh and texture pair with
+// instances is one instanced draw.
+class MeshRenderer
+{
+public:
+	// Uses the shared buffers of meshes and adds the per-instance attributes to its layout
+	MeshRenderer(BufferManager& meshes, GLuint positionScaleLayout, GLuint colorLayout);
+
+	// Takes ownership of a mesh from the shared buffers and returns the id to draw it with
+	GLuint AddMesh(Mesh mesh);
+
+	// Forgets the queued instances; until Clear is called again Draw keeps drawing the same ones
+	// without packing or uploading anything
+	void Clear();
+	// Queues one instance of a mesh for the next Draw, optionally textured with a GL texture
+	void AddInstance(GLuint meshId, const InstanceData& instance, GLuint texture = 0);
+	// Uploads the queued instances if they changed and draws them; the shader must be active and
+	// have a "useTexture" bool and a sampler reading texture unit 0
+	void Draw(Shader& shader);
+
+	// Whether the context can use the multi-draw indirect path
+	bool SupportsIndirect() const;
+
+	// Set to false to force the instanced fallback even when indirect drawing is available
+	bool useIndirect = true;
+
+	GLsizei DrawCalls() const { return drawCalls; }
+	GLsizei MeshCount() const { return static_cast<GLsizei>(meshList.size()); }
+	size_t InstanceCount() const { return instanceData.size(); }
+	// Bytes of CPU-side instance and command data, including the room kept between frames
+	size_t MemoryBytes() const;
+
+private:
+	// Layout defined by the GL spec for glMultiDrawElementsIndirect
+	struct DrawElementsIndirectCommand
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// Instances of one mesh with one texture
+	struct Batch
+	{
+		GLuint meshId;
+		GLuint texture;
+		std::vector<InstanceData> instances;
+	};
+
+	BufferManager& meshes;
+	std::vector<Mesh> meshList;
+	// Instances are collected per batch, then packed so each batch's instances are contiguous.
+	// Batches are kept across frames so their vectors keep their capacity.
+	std::vector<Batch> batches;
+	std::unordered_map<uint64_t, size_t> batchLookup;
+	// Batch indices sorted by texture, so each texture is bound once
+	std::vector<size_t> batchOrder;
+	std::vector<InstanceData> instanceData;
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<GLuint> commandTextures;
+	VBO instanceBuffer;
+	VBO indirectBuffer;
+	GLsizei drawCalls = 0;
+	// Whether the queued instances differ from what the buffers hold
+	bool instancesDirty = true;
+	bool commandsUploaded = false;
+};
+
+#endif
\ No newline at end of file
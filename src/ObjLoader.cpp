@@ -0,0 +1,590 @@
+#include"ObjLoader.h"
+
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<filesystem>
+#include<fstream>
+#include<iostream>
+#include<string_view>
+#include<unordered_map>
+
+#include"MappedFile.h"
+
+namespace
+{
+	const char meshCacheMagic[4] = { 'J', 'M', 'S', 'H' };
+	const uint32_t meshCacheVersion = 4;
+	const uint32_t floatsPerVertex = 11;
+
+	struct MeshCacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t stamp;
+		uint32_t floatsPerVertex;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		// Followed by one entry per material library, then the vertices and indices
+		uint32_t libraryCount;
+	};
+
+	// A material library in the cache: its stamp, then the length of its path and the path itself
+	struct MeshCacheLibrary
+	{
+		uint64_t stamp;
+		uint32_t pathBytes;
+		uint32_t reserved;
+	};
+
+	// Walks a memory-mapped text file token by token without copying or allocating
+	struct Cursor
+	{
+		const char* p;
+		const char* end;
+
+		bool AtEnd() const { return p >= end; }
+
+		// Skips spaces and tabs but stops at the end of the line
+		void SkipSpaces()
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+			{
+				p++;
+			}
+		}
+
+		// Moves to the first character of the next line
+		void NextLine()
+		{
+			while (p < end && *p != '\n')
+			{
+				p++;
+			}
+			if (p < end)
+			{
+				p++;
+			}
+		}
+
+		// Returns the next whitespace-separated token on this line as a view into the file
+		std::string_view Token()
+		{
+			SkipSpaces();
+			const char* start = p;
+			while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+			{
+				p++;
+			}
+			return std::string_view(start, static_cast<size_t>(p - start));
+		}
+
+		// Returns the rest of the line with surrounding whitespace removed, used for names
+		std::string_view Rest()
+		{
+			SkipSpaces();
+			const char* start = p;
+			while (p < end && *p != '\n')
+			{
+				p++;
+			}
+			const char* last = p;
+			while (last > start && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
+			{
+				last--;
+			}
+			return std::string_view(start, static_cast<size_t>(last - start));
+		}
+
+		// Parses a decimal number such as -1.25e-3; the file is not null terminated, so strtof cannot be used
+		float Float()
+		{
+			SkipSpaces();
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negative = *p == '-';
+				p++;
+			}
+			uint64_t mantissa = 0;
+			int exponent = 0;
+			while (p < end && *p >= '0' && *p <= '9')
+			{
+				if (mantissa < 100000000000000000ULL)
+				{
+					mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+				}
+				else
+				{
+					exponent++;
+				}
+				p++;
+			}
+			if (p < end && *p == '.')
+			{
+				p++;
+				while (p < end && *p >= '0' && *p <= '9')
+				{
+					if (mantissa < 100000000000000000ULL)
+					{
+						mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+						exponent--;
+					}
+					p++;
+				}
+			}
+			if (p < end && (*p == 'e' || *p == 'E'))
+			{
+				p++;
+				bool negativeExponent = false;
+				if (p < end && (*p == '-' || *p == '+'))
+				{
+					negativeExponent = *p == '-';
+					p++;
+				}
+				int value = 0;
+				while (p < end && *p >= '0' && *p <= '9')
+				{
+					value = value * 10 + (*p - '0');
+					p++;
+				}
+				exponent += negativeExponent ? -value : value;
+			}
+			double result = static_cast<double>(mantissa);
+			if (exponent != 0)
+			{
+				result *= std::pow(10.0, exponent);
+			}
+			return static_cast<float>(negative ? -result : result);
+		}
+
+		// Parses a signed integer, as used by face indices
+		long Int()
+		{
+			bool negative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negative = *p == '-';
+				p++;
+			}
+			long value = 0;
+			while (p < end && *p >= '0' && *p <= '9')
+			{
+				value = value * 10 + (*p - '0');
+				p++;
+			}
+			return negative ? -value : value;
+		}
+	};
+
+	// What makes two face corners the same vertex. A corner without a normal in the file gets the normal
+	// of its face, so normal is then -2 - the face number and the vertex is not shared with other faces.
+	struct VertexKey
+	{
+		long position;
+		long texCoord;
+		long normal;
+		int material;
+
+		bool operator==(const VertexKey& other) const
+		{
+			return position == other.position && texCoord == other.texCoord && normal == other.normal && material == other.material;
+		}
+	};
+
+	struct VertexKeyHash
+	{
+		size_t operator()(const VertexKey& key) const
+		{
+			uint64_t hash = static_cast<uint64_t>(key.position) * 0x9E3779B97F4A7C15ULL;
+			hash ^= static_cast<uint64_t>(key.texCoord) * 0xC2B2AE3D27D4EB4FULL + (hash << 6) + (hash >> 2);
+			hash ^= static_cast<uint64_t>(key.normal) * 0x165667B19E3779F9ULL + (hash << 6) + (hash >> 2);
+			hash ^= static_cast<uint64_t>(key.material) + (hash << 6) + (hash >> 2);
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	// Turns a 1-based or negative (relative) OBJ index into a 0-based one, or -1 if it is out of range
+	long resolveIndex(long index, size_t count)
+	{
+		long resolved = index < 0 ? static_cast<long>(count) + index : index - 1;
+		return resolved >= 0 && resolved < static_cast<long>(count) ? resolved : -1;
+	}
+
+	// Identifies the version of the source file so stale caches are ignored
+	bool sourceStamp(const char* path, unsigned long long& stamp)
+	{
+		std::error_code error;
+		auto size = std::filesystem::file_size(path, error);
+		if (error)
+		{
+			return false;
+		}
+		auto modified = std::filesystem::last_write_time(path, error);
+		if (error)
+		{
+			return false;
+		}
+		uint64_t ticks = static_cast<uint64_t>(modified.time_since_epoch().count());
+		stamp = ticks ^ (static_cast<uint64_t>(size) * 0x9E3779B97F4A7C15ULL);
+		return true;
+	}
+
+	// Stamp of a material library, 0 if it cannot be read; a library that is missing both times matches
+	uint64_t libraryStamp(const std::string& path)
+	{
+		unsigned long long stamp = 0;
+		return sourceStamp(path.c_str(), stamp) ? stamp : 0;
+	}
+
+	// Reads the Kd of every material of an MTL file; names are kept as views into the mapped file
+	void parseMaterials(const MappedFile& file, std::unordered_map<std::string_view, int>& materialIds, std::vector<float>& colors)
+	{
+		Cursor cursor{ file.Data(), file.Data() + file.Size() };
+		int current = -1;
+		while (!cursor.AtEnd())
+		{
+			std::string_view keyword = cursor.Token();
+			if (keyword == "newmtl")
+			{
+				current = static_cast<int>(colors.size() / 3);
+				materialIds[cursor.Rest()] = current;
+				colors.insert(colors.end(), { 1.0f, 1.0f, 1.0f });
+			}
+			else if (keyword == "Kd" && current >= 0)
+			{
+				colors[current * 3 + 0] = cursor.Float();
+				colors[current * 3 + 1] = cursor.Float();
+				colors[current * 3 + 2] = cursor.Float();
+			}
+			cursor.NextLine();
+		}
+	}
+}
+
+// Parses an OBJ file without looking at or writing the cache
+bool parseObjMesh(const char* path, MeshData& mesh, std::vector<std::string>* materialLibraries)
+{
+	MappedFile file(path);
+	if (!file.Valid())
+	{
+		std::cout << "parseObjMesh could not open: " << path << std::endl;
+		return false;
+	}
+
+	// Material library mappings stay open while parsing so material names can stay views into them
+	std::vector<MappedFile> materialFiles;
+	std::unordered_map<std::string_view, int> materialIds;
+	std::vector<float> materialColors;
+	std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+	std::vector<float> positions;
+	std::vector<float> texCoords;
+	std::vector<float> normals;
+	// Rough guess from the file size so the arrays rarely grow while parsing
+	positions.reserve(file.Size() / 32);
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	mesh.indices.reserve(file.Size() / 16);
+
+	// Vertices are deduplicated on what ends up in the vertex: position, texture coordinate, normal and material color
+	std::unordered_map<VertexKey, unsigned int, VertexKeyHash> vertexIds;
+	vertexIds.reserve(file.Size() / 64);
+
+	int material = -1;
+	long faceCount = 0;
+	// Corners of the face being read; they grow to the largest polygon and are reused for every face
+	std::vector<VertexKey> corners;
+	std::vector<unsigned int> face;
+	Cursor cursor{ file.Data(), file.Data() + file.Size() };
+	while (!cursor.AtEnd())
+	{
+		std::string_view keyword = cursor.Token();
+		if (keyword == "v")
+		{
+			positions.push_back(cursor.Float());
+			positions.push_back(cursor.Float());
+			positions.push_back(cursor.Float());
+		}
+		else if (keyword == "vt")
+		{
+			texCoords.push_back(cursor.Float());
+			texCoords.push_back(cursor.Float());
+		}
+		else if (keyword == "vn")
+		{
+			normals.push_back(cursor.Float());
+			normals.push_back(cursor.Float());
+			normals.push_back(cursor.Float());
+		}
+		else if (keyword == "f")
+		{
+			size_t positionCount = positions.size() / 3;
+			size_t texCoordCount = texCoords.size() / 2;
+			size_t normalCount = normals.size() / 3;
+			corners.clear();
+			while (true)
+			{
+				cursor.SkipSpaces();
+				if (cursor.AtEnd() || *cursor.p == '\n' || *cursor.p == '#')
+				{
+					break;
+				}
+				long position = resolveIndex(cursor.Int(), positionCount);
+				long texCoord = -1;
+				long normal = -1;
+				if (!cursor.AtEnd() && *cursor.p == '/')
+				{
+					cursor.p++;
+					// v//vn has no texture coordinate
+					if (!cursor.AtEnd() && *cursor.p != '/')
+					{
+						texCoord = resolveIndex(cursor.Int(), texCoordCount);
+					}
+					if (!cursor.AtEnd() && *cursor.p == '/')
+					{
+						cursor.p++;
+						normal = resolveIndex(cursor.Int(), normalCount);
+					}
+				}
+				while (!cursor.AtEnd() && *cursor.p != ' ' && *cursor.p != '\t' && *cursor.p != '\r' && *cursor.p != '\n')
+				{
+					cursor.p++;
+				}
+				if (position < 0)
+				{
+					std::cout << "parseObjMesh found an invalid face index in: " << path << std::endl;
+					return false;
+				}
+				corners.push_back({ position, texCoord, normal, material });
+			}
+			int cornerCount = static_cast<int>(corners.size());
+			face.resize(corners.size());
+
+			// Corners without a normal get the face's, from Newell's method so polygons that are not quite planar work too
+			float faceNormal[3] = { 0.0f, 0.0f, 0.0f };
+			for (int i = 0; i < cornerCount; i++)
+			{
+				const float* a = &positions[corners[i].position * 3];
+				const float* b = &positions[corners[(i + 1) % cornerCount].position * 3];
+				faceNormal[0] += (a[1] - b[1]) * (a[2] + b[2]);
+				faceNormal[1] += (a[2] - b[2]) * (a[0] + b[0]);
+				faceNormal[2] += (a[0] - b[0]) * (a[1] + b[1]);
+			}
+			float length = std::sqrt(faceNormal[0] * faceNormal[0] + faceNormal[1] * faceNormal[1] + faceNormal[2] * faceNormal[2]);
+			if (length > 0.0f)
+			{
+				faceNormal[0] /= length;
+				faceNormal[1] /= length;
+				faceNormal[2] /= length;
+			}
+
+			for (int i = 0; i < cornerCount; i++)
+			{
+				VertexKey& key = corners[i];
+				if (key.normal < 0)
+				{
+					key.normal = -2 - faceCount;
+				}
+				auto inserted = vertexIds.emplace(key, static_cast<unsigned int>(mesh.vertices.size() / floatsPerVertex));
+				if (inserted.second)
+				{
+					const float* coordinates = &positions[key.position * 3];
+					mesh.vertices.insert(mesh.vertices.end(), coordinates, coordinates + 3);
+					if (material >= 0)
+					{
+						const float* color = &materialColors[material * 3];
+						mesh.vertices.insert(mesh.vertices.end(), color, color + 3);
+					}
+					else
+					{
+						mesh.vertices.insert(mesh.vertices.end(), { 1.0f, 1.0f, 1.0f });
+					}
+					if (key.texCoord >= 0)
+					{
+						const float* uv = &texCoords[key.texCoord * 2];
+						mesh.vertices.insert(mesh.vertices.end(), uv, uv + 2);
+					}
+					else
+					{
+						mesh.vertices.insert(mesh.vertices.end(), { 0.0f, 0.0f });
+					}
+					const float* direction = key.normal >= 0 ? &normals[key.normal * 3] : faceNormal;
+					mesh.vertices.insert(mesh.vertices.end(), direction, direction + 3);
+				}
+				face[i] = inserted.first->second;
+			}
+			faceCount++;
+
+			// Polygons are split into a triangle fan
+			for (int i = 2; i < cornerCount; i++)
+			{
+				mesh.indices.push_back(face[0]);
+				mesh.indices.push_back(face[i - 1]);
+				mesh.indices.push_back(face[i]);
+			}
+		}
+		else if (keyword == "usemtl")
+		{
+			auto found = materialIds.find(cursor.Rest());
+			material = found != materialIds.end() ? found->second : -1;
+		}
+		else if (keyword == "mtllib")
+		{
+			std::string_view name = cursor.Rest();
+			std::string materialPath = (directory / std::string(name)).string();
+			if (materialLibraries != nullptr)
+			{
+				materialLibraries->push_back(materialPath);
+			}
+			MappedFile materialFile(materialPath.c_str());
+			if (materialFile.Valid())
+			{
+				parseMaterials(materialFile, materialIds, materialColors);
+				materialFiles.push_back(std::move(materialFile));
+			}
+			else
+			{
+				std::cout << "parseObjMesh could not open material library: " << materialPath << std::endl;
+			}
+		}
+		cursor.NextLine();
+	}
+
+	if (mesh.indices.empty())
+	{
+		std::cout << "parseObjMesh found no faces in: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Reads the binary cache with a single read; fails if it is missing, stale or malformed
+bool readMeshCache(const std::string& cachePath, unsigned long long stamp, MeshData& mesh)
+{
+	std::ifstream in(cachePath, std::ios::binary | std::ios::ate);
+	if (!in)
+	{
+		return false;
+	}
+	std::streamsize size = in.tellg();
+	if (size < static_cast<std::streamsize>(sizeof(MeshCacheHeader)))
+	{
+		return false;
+	}
+	std::vector<char> contents(static_cast<size_t>(size));
+	in.seekg(0, std::ios::beg);
+	if (!in.read(contents.data(), size))
+	{
+		return false;
+	}
+
+	MeshCacheHeader header;
+	std::memcpy(&header, contents.data(), sizeof(header));
+	if (std::memcmp(header.magic, meshCacheMagic, sizeof(meshCacheMagic)) != 0 || header.version != meshCacheVersion
+		|| header.stamp != stamp || header.floatsPerVertex != floatsPerVertex)
+	{
+		return false;
+	}
+
+	// Colors come from the material libraries, so an edited library makes the cache stale too
+	size_t offset = sizeof(header);
+	for (uint32_t i = 0; i < header.libraryCount; i++)
+	{
+		MeshCacheLibrary library;
+		if (contents.size() - offset < sizeof(library))
+		{
+			return false;
+		}
+		std::memcpy(&library, contents.data() + offset, sizeof(library));
+		offset += sizeof(library);
+		if (contents.size() - offset < library.pathBytes)
+		{
+			return false;
+		}
+		std::string libraryPath(contents.data() + offset, library.pathBytes);
+		offset += library.pathBytes;
+		if (libraryStamp(libraryPath) != library.stamp)
+		{
+			return false;
+		}
+	}
+
+	size_t vertexBytes = static_cast<size_t>(header.vertexCount) * floatsPerVertex * sizeof(float);
+	size_t indexBytes = static_cast<size_t>(header.indexCount) * sizeof(unsigned int);
+	if (contents.size() != offset + vertexBytes + indexBytes)
+	{
+		return false;
+	}
+
+	const char* data = contents.data() + offset;
+	mesh.vertices.resize(static_cast<size_t>(header.vertexCount) * floatsPerVertex);
+	std::memcpy(mesh.vertices.data(), data, vertexBytes);
+	mesh.indices.resize(header.indexCount);
+	std::memcpy(mesh.indices.data(), data + vertexBytes, indexBytes);
+	return true;
+}
+
+// Writes the binary cache through a temporary file so a crash never leaves a torn cache behind
+bool writeMeshCache(const std::string& cachePath, unsigned long long stamp, const std::vector<std::string>& materialLibraries,
+	const MeshData& mesh)
+{
+	MeshCacheHeader header = {};
+	std::memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+	header.version = meshCacheVersion;
+	header.stamp = stamp;
+	header.floatsPerVertex = floatsPerVertex;
+	header.vertexCount = static_cast<uint32_t>(mesh.vertices.size() / floatsPerVertex);
+	header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	header.libraryCount = static_cast<uint32_t>(materialLibraries.size());
+
+	std::string temporaryPath = cachePath + ".tmp";
+	{
+		std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			return false;
+		}
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		for (const std::string& libraryPath : materialLibraries)
+		{
+			MeshCacheLibrary library = {};
+			library.stamp = libraryStamp(libraryPath);
+			library.pathBytes = static_cast<uint32_t>(libraryPath.size());
+			out.write(reinterpret_cast<const char*>(&library), sizeof(library));
+			out.write(libraryPath.data(), libraryPath.size());
+		}
+		out.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(float));
+		out.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(unsigned int));
+		if (!out)
+		{
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, cachePath, error);
+	return !error;
+}
+
+// Loads an OBJ file into an indexed mesh, going through the binary cache when it is up to date
+bool loadObjMesh(const char* path, MeshData& mesh)
+{
+	std::string cachePath = std::string(path) + ".meshcache";
+	unsigned long long stamp = 0;
+	bool stamped = sourceStamp(path, stamp);
+	if (stamped && readMeshCache(cachePath, stamp, mesh))
+	{
+		return true;
+	}
+
+	std::vector<std::string> materialLibraries;
+	if (!parseObjMesh(path, mesh, &materialLibraries))
+	{
+		return false;
+	}
+	if (stamped && !writeMeshCache(cachePath, stamp, materialLibraries, mesh))
+	{
+		std::cout << "loadObjMesh could not write cache: " << cachePath << std::endl;
+	}
+	return true;
+}
\ No newline at end of file
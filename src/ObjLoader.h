@@ -0,0 +1,32 @@
+#ifndef OBJ_LOADER_CLASS_H
+#define OBJ_LOADER_CLASS_H
+
+#include<string>
+#include<vector>
+
+// Indexed mesh in the body vertex layout: position (3 floats), color (3 floats), texture coordinate (2 floats),
+// normal (3 floats)
+struct MeshData
+{
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+};
+
+// Loads a Wavefront OBJ file into an indexed mesh. Vertex colors come from the Kd of the
+// material in use; normals come from the file, or from the face where a corner has none.
+// A binary copy is written next to the OBJ (<path>.meshcache) and later loads read that
+// with a single read as long as neither the OBJ nor its material libraries have changed.
+// Returns false and prints the reason if neither the cache nor the OBJ could be loaded.
+bool loadObjMesh(const char* path, MeshData& mesh);
+
+// Parses an OBJ file without looking at or writing the cache; the paths of the material libraries it
+// references go to materialLibraries if it is not null
+bool parseObjMesh(const char* path, MeshData& mesh, std::vector<std::string>* materialLibraries = nullptr);
+
+// Reads and writes the binary cache; the stamp identifies the version of the source file. The cache also
+// records the material libraries with their stamps, and reading fails if any of them changed.
+bool readMeshCache(const std::string& cachePath, unsigned long long stamp, MeshData& mesh);
+bool writeMeshCache(const std::string& cachePath, unsigned long long stamp, const std::vector<std::string>& materialLibraries,
+	const MeshData& mesh);
+
+#endif
\ No newline at end of file
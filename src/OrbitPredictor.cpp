@@ -0,0 +1,202 @@
+#include"OrbitPredictor.h"
+
+#include<algorithm>
+#include<utility>
+
+#include"Tracer.h"
+
+namespace
+{
+	// Points integrated between publishing the path and checking for a newer request
+	const int publishInterval = 64;
+
+	// Pairs closer than this are skipped, as in the real force calculation
+	const double minimumDistance = 0.1;
+
+	// Acceleration at position from every massive body except skip
+	glm::dvec3 accelerationAt(const glm::dvec3& position, const std::vector<PredictorBody>& bodies, double gravity, int skip)
+	{
+		glm::dvec3 acceleration(0.0);
+		for (size_t j = 0; j < bodies.size(); j++)
+		{
+			if (static_cast<int>(j) == skip)
+			{
+				continue;
+			}
+			glm::dvec3 offset = bodies[j].position - position;
+			double distance = glm::length(offset);
+			if (distance < minimumDistance)
+			{
+				continue;
+			}
+			acceleration += offset * (gravity * bodies[j].mass / (distance * distance * distance));
+		}
+		return acceleration;
+	}
+}
+
+// Starts the worker thread
+OrbitPredictor::OrbitPredictor()
+{
+	worker = std::thread(&OrbitPredictor::WorkerLoop, this);
+}
+
+// Stops the worker
+OrbitPredictor::~OrbitPredictor()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+// Starts predicting from a new state
+void OrbitPredictor::Submit(PredictionRequest request)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++submitted;
+		pending = std::move(request);
+		hasPending = true;
+	}
+	wake.notify_one();
+}
+
+// Abandons the prediction and forgets the path
+void OrbitPredictor::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	completed = ++submitted;
+	hasPending = false;
+	published.clear();
+	hasPublished = true;
+}
+
+// Copies the path if it grew or changed since the last call
+bool OrbitPredictor::Poll(std::vector<glm::dvec3>& path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!hasPublished)
+	{
+		return false;
+	}
+	path = published;
+	hasPublished = false;
+	return true;
+}
+
+// Whether the newest prediction is still being integrated
+bool OrbitPredictor::Busy() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return completed != submitted;
+}
+
+// Runs queued requests until the predictor is destroyed
+void OrbitPredictor::WorkerLoop()
+{
+	Tracer::NameThread("Orbit predictor");
+	PredictionRequest request;
+	while (true)
+	{
+		uint64_t generation;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || hasPending; });
+			if (stopping)
+			{
+				return;
+			}
+			std::swap(request, pending);
+			hasPending = false;
+			generation = submitted;
+		}
+		TraceZone zone("Predict orbit");
+		Run(request, generation);
+	}
+}
+
+// Integrates one request with kick-drift-kick leapfrog, the massive bodies pulling on each other and on the
+// target. The path keeps the previous prediction's points until the new one has reached them, so a refresh
+// while the simulation runs extends and corrects the line instead of making it flicker from empty.
+bool OrbitPredictor::Run(const PredictionRequest& request, uint64_t generation)
+{
+	std::vector<PredictorBody> bodies = request.massive;
+	bool testParticle = request.target < 0 || request.target >= static_cast<int>(bodies.size());
+	glm::dvec3 position = testParticle ? request.targetPosition : bodies[request.target].position;
+	glm::dvec3 velocity = testParticle ? request.targetVelocity : bodies[request.target].velocity;
+	int points = std::max(request.points, 2);
+	int substeps = std::max(request.stepsPerPoint, 1);
+	double dt = request.horizon / (static_cast<double>(points - 1) * substeps);
+
+	std::vector<glm::dvec3> accelerations(bodies.size());
+	for (size_t i = 0; i < bodies.size(); i++)
+	{
+		accelerations[i] = accelerationAt(bodies[i].position, bodies, request.gravity, static_cast<int>(i));
+	}
+	glm::dvec3 acceleration = testParticle ? accelerationAt(position, bodies, request.gravity, -1) : glm::dvec3(0.0);
+
+	std::vector<glm::dvec3> path;
+	path.reserve(points);
+	path.push_back(position);
+	for (int point = 1; point < points; point++)
+	{
+		for (int step = 0; step < substeps; step++)
+		{
+			for (size_t i = 0; i < bodies.size(); i++)
+			{
+				bodies[i].velocity += accelerations[i] * (dt * 0.5);
+				bodies[i].position += bodies[i].velocity * dt;
+			}
+			if (testParticle)
+			{
+				velocity += acceleration * (dt * 0.5);
+				position += velocity * dt;
+			}
+			for (size_t i = 0; i < bodies.size(); i++)
+			{
+				accelerations[i] = accelerationAt(bodies[i].position, bodies, request.gravity, static_cast<int>(i));
+				bodies[i].velocity += accelerations[i] * (dt * 0.5);
+			}
+			if (testParticle)
+			{
+				acceleration = accelerationAt(position, bodies, request.gravity, -1);
+				velocity += acceleration * (dt * 0.5);
+			}
+		}
+		path.push_back(testParticle ? position : bodies[request.target].position);
+
+		if (point % publishInterval == 0 && !Publish(path, generation, false))
+		{
+			return false;
+		}
+	}
+	return Publish(path, generation, true);
+}
+
+// Hands the path so far to the main thread, returns false if a newer request arrived meanwhile
+bool OrbitPredictor::Publish(const std::vector<glm::dvec3>& path, uint64_t generation, bool done)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (generation != submitted)
+	{
+		return false;
+	}
+	// Until the new path is as long as the old one, the old one's tail is kept behind it
+	if (path.size() < published.size() && !done)
+	{
+		std::copy(path.begin(), path.end(), published.begin());
+	}
+	else
+	{
+		published = path;
+	}
+	hasPublished = true;
+	if (done)
+	{
+		completed = generation;
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#ifndef ORBIT_PREDICTOR_CLASS_H
+#define ORBIT_PREDICTOR_CLASS_H
+
+#include<condition_variable>
+#include<cstdint>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#include<glm/glm.hpp>
+
+// One body of the reduced model a prediction integrates
+struct PredictorBody
+{
+	glm::dvec3 position;
+	glm::dvec3 velocity;
+	double mass;
+};
+
+// A copy of the state to predict from and how far ahead to look
+struct PredictionRequest
+{
+	std::vector<PredictorBody> massive; // the bodies that pull, usually the heaviest few
+	int target = -1;                    // index of the predicted body in massive, or -1 for a test particle
+	glm::dvec3 targetPosition = glm::dvec3(0.0); // the test particle's state when target is -1
+	glm::dvec3 targetVelocity = glm::dvec3(0.0);
+	double gravity = 1.0;
+	double horizon = 86400.0;  // simulated seconds ahead
+	int points = 1000;         // path points, evenly spaced in time
+	int stepsPerPoint = 8;
+};
+
+// Integrates a reduced copy of the simulation ahead on its own thread and keeps the predicted path of
+// one body. The model only holds the bodies in the request, which pull on each other directly, and
+// takes far larger steps than the real simulation, so a prediction days ahead takes milliseconds.
+// The path is published in pieces as it grows; submitting a new request abandons the one in flight.
+class OrbitPredictor
+{
+public:
+	// Starts the worker thread
+	OrbitPredictor();
+	// Stops the worker
+	~OrbitPredictor();
+
+	OrbitPredictor(const OrbitPredictor&) = delete;
+	OrbitPredictor& operator=(const OrbitPredictor&) = delete;
+
+	// Starts predicting from a new state
+	void Submit(PredictionRequest request);
+	// Abandons the prediction and forgets the path
+	void Clear();
+	// Copies the path if it grew or changed since the last call, returns whether it did
+	bool Poll(std::vector<glm::dvec3>& path);
+	// Whether the newest prediction is still being integrated
+	bool Busy() const;
+
+private:
+	// Runs queued requests until the predictor is destroyed
+	void WorkerLoop();
+	// Integrates one request, returns false if a newer one arrived meanwhile
+	bool Run(const PredictionRequest& request, uint64_t generation);
+	// Hands the path so far to the main thread, returns false if a newer request arrived meanwhile
+	bool Publish(const std::vector<glm::dvec3>& path, uint64_t generation, bool done);
+
+	// Shared with the worker
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	PredictionRequest pending;
+	bool hasPending = false;
+	uint64_t submitted = 0;
+	uint64_t completed = 0;
+	std::vector<glm::dvec3> published;
+	bool hasPublished = false;
+	bool stopping = false;
+	std::thread worker;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,627 @@
+#include"ParticleImport.h"
+
+#include<algorithm>
+#include<cctype>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<string_view>
+#include<vector>
+#include<omp.h>
+
+#include"MappedFile.h"
+
+namespace
+{
+	// Header block of a Gadget-2 snapshot, 256 bytes including the padding
+	struct GadgetHeader
+	{
+		int32_t npart[6];
+		double mass[6];
+		double time;
+		double redshift;
+		int32_t flagSfr;
+		int32_t flagFeedback;
+		uint32_t npartTotal[6];
+		int32_t flagCooling;
+		int32_t numFiles;
+		double boxSize;
+		double omega0;
+		double omegaLambda;
+		double hubbleParam;
+		int32_t flagStellarAge;
+		int32_t flagMetals;
+		uint32_t npartTotalHighWord[6];
+		int32_t flagEntropyInsteadU;
+		char fill[60];
+	};
+	static_assert(sizeof(GadgetHeader) == 256, "Gadget header must be 256 bytes");
+
+	// Walks the Fortran records of a Gadget file: a 4-byte length, the data, the length again.
+	// Format 2 files put an 8-byte record holding a 4-character label in front of every block.
+	struct GadgetBlocks
+	{
+		const char* p;
+		const char* end;
+		bool labeled;
+
+		// Reads the next block, returns false at the end of the file or if the record is damaged
+		bool Next(std::string_view& label, const char*& data, uint32_t& size)
+		{
+			label = std::string_view();
+			if (labeled)
+			{
+				const char* labelData;
+				uint32_t labelSize;
+				if (!Record(labelData, labelSize) || labelSize != 8)
+				{
+					return false;
+				}
+				label = std::string_view(labelData, 4);
+			}
+			return Record(data, size);
+		}
+
+		bool Record(const char*& data, uint32_t& size)
+		{
+			if (end - p < 8)
+			{
+				return false;
+			}
+			std::memcpy(&size, p, 4);
+			if (static_cast<size_t>(end - p) < static_cast<size_t>(size) + 8)
+			{
+				return false;
+			}
+			uint32_t trailer;
+			std::memcpy(&trailer, p + 4 + size, 4);
+			if (trailer != size)
+			{
+				return false;
+			}
+			data = p + 4;
+			p += size + 8;
+			return true;
+		}
+	};
+
+	// Reads element i of an array of floats or doubles that may not be aligned in the mapping
+	double readReal(const char* data, size_t i, bool doublePrecision)
+	{
+		if (doublePrecision)
+		{
+			double value;
+			std::memcpy(&value, data + i * sizeof(double), sizeof(double));
+			return value;
+		}
+		float value;
+		std::memcpy(&value, data + i * sizeof(float), sizeof(float));
+		return value;
+	}
+
+	// Reads one Gadget file into rows [first, first + count of the file) of out
+	bool readGadgetFile(const std::string& path, const ImportUnits& units, SnapshotData& out, size_t first, std::string& error)
+	{
+		MappedFile file(path.c_str());
+		if (!file.Valid())
+		{
+			error = "could not open " + path;
+			return false;
+		}
+		uint32_t firstRecord = 0;
+		if (file.Size() >= 4)
+		{
+			std::memcpy(&firstRecord, file.Data(), 4);
+		}
+		if (firstRecord != 256 && firstRecord != 8)
+		{
+			error = path + " is not a little endian Gadget-2 snapshot";
+			return false;
+		}
+		GadgetBlocks blocks = { file.Data(), file.Data() + file.Size(), firstRecord == 8 };
+
+		std::string_view label;
+		const char* data;
+		uint32_t size;
+		if (!blocks.Next(label, data, size) || size != sizeof(GadgetHeader))
+		{
+			error = path + " has no Gadget header";
+			return false;
+		}
+		GadgetHeader header;
+		std::memcpy(&header, data, sizeof(header));
+
+		size_t count = 0;
+		size_t massesInBlock = 0;
+		for (int type = 0; type < 6; type++)
+		{
+			count += static_cast<size_t>(header.npart[type]);
+			if (header.mass[type] == 0.0)
+			{
+				massesInBlock += static_cast<size_t>(header.npart[type]);
+			}
+		}
+		if (first + count > out.BodyCount())
+		{
+			error = path + " holds more particles than its header announced";
+			return false;
+		}
+
+		// Format 1 blocks come in a fixed order; format 2 labels them
+		const char* positions = nullptr;
+		const char* velocities = nullptr;
+		const char* masses = nullptr;
+		uint32_t positionBytes = 0, velocityBytes = 0, massBytes = 0;
+		for (int block = 0; blocks.Next(label, data, size); block++)
+		{
+			bool isPositions = blocks.labeled ? label == "POS " : block == 0;
+			bool isVelocities = blocks.labeled ? label == "VEL " : block == 1;
+			bool isMasses = blocks.labeled ? label == "MASS" : block == 3;
+			if (isPositions) { positions = data; positionBytes = size; }
+			if (isVelocities) { velocities = data; velocityBytes = size; }
+			if (isMasses) { masses = data; massBytes = size; }
+		}
+		if (positions == nullptr || velocities == nullptr || (massesInBlock > 0 && masses == nullptr))
+		{
+			error = path + " is missing its position, velocity or mass block";
+			return false;
+		}
+		if (count == 0)
+		{
+			return true;
+		}
+		bool doublePositions = positionBytes == count * 3 * sizeof(double);
+		bool doubleVelocities = velocityBytes == count * 3 * sizeof(double);
+		bool doubleMasses = massesInBlock > 0 && massBytes == massesInBlock * sizeof(double);
+		if ((!doublePositions && positionBytes != count * 3 * sizeof(float))
+			|| (!doubleVelocities && velocityBytes != count * 3 * sizeof(float))
+			|| (massesInBlock > 0 && !doubleMasses && massBytes != massesInBlock * sizeof(float)))
+		{
+			error = path + " has blocks that do not match its particle counts";
+			return false;
+		}
+
+		// Particles are stored type after type; a type either has one mass in the header or its masses in the block
+		size_t typeStart = 0;
+		size_t massStart = 0;
+		for (int type = 0; type < 6; type++)
+		{
+			size_t typeCount = static_cast<size_t>(header.npart[type]);
+			double typeMass = header.mass[type];
+			#pragma omp parallel for
+			for (long long k = 0; k < static_cast<long long>(typeCount); k++)
+			{
+				size_t i = typeStart + static_cast<size_t>(k);
+				size_t row = first + i;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					out.positions[3 * row + axis] = readReal(positions, 3 * i + axis, doublePositions) * units.length;
+					out.velocities[3 * row + axis] = readReal(velocities, 3 * i + axis, doubleVelocities) * units.velocity;
+				}
+				double mass = typeMass != 0.0 ? typeMass : readReal(masses, massStart + static_cast<size_t>(k), doubleMasses);
+				out.masses[row] = mass * units.mass;
+			}
+			typeStart += typeCount;
+			if (typeMass == 0.0)
+			{
+				massStart += typeCount;
+			}
+		}
+		return true;
+	}
+
+	// Reads the header of a Gadget file for the particle count and the number of files
+	bool readGadgetCounts(const std::string& path, size_t& count, int& files, std::string& error)
+	{
+		MappedFile file(path.c_str());
+		uint32_t firstRecord = 0;
+		if (file.Valid() && file.Size() >= 4)
+		{
+			std::memcpy(&firstRecord, file.Data(), 4);
+		}
+		GadgetBlocks blocks = { file.Data(), file.Data() + file.Size(), firstRecord == 8 };
+		std::string_view label;
+		const char* data;
+		uint32_t size;
+		if (!file.Valid() || (firstRecord != 256 && firstRecord != 8) || !blocks.Next(label, data, size) || size != sizeof(GadgetHeader))
+		{
+			error = path + " is not a little endian Gadget-2 snapshot";
+			return false;
+		}
+		GadgetHeader header;
+		std::memcpy(&header, data, sizeof(header));
+		count = 0;
+		for (int type = 0; type < 6; type++)
+		{
+			count += static_cast<size_t>(header.npart[type]);
+		}
+		files = std::max(header.numFiles, 1);
+		return true;
+	}
+
+	// Parses a decimal number such as -1.25e-3 without reading past end; the mapping is not null terminated
+	bool parseNumber(const char*& p, const char* end, double& value)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+		uint64_t mantissa = 0;
+		int exponent = 0;
+		bool digits = false;
+		while (p < end && *p >= '0' && *p <= '9')
+		{
+			if (mantissa < 100000000000000000ULL)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+			}
+			else
+			{
+				exponent++;
+			}
+			digits = true;
+			p++;
+		}
+		if (p < end && *p == '.')
+		{
+			p++;
+			while (p < end && *p >= '0' && *p <= '9')
+			{
+				if (mantissa < 100000000000000000ULL)
+				{
+					mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+					exponent--;
+				}
+				digits = true;
+				p++;
+			}
+		}
+		if (!digits)
+		{
+			return false;
+		}
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			p++;
+			bool negativeExponent = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negativeExponent = *p == '-';
+				p++;
+			}
+			int written = 0;
+			while (p < end && *p >= '0' && *p <= '9')
+			{
+				written = std::min(written * 10 + (*p - '0'), 100000);
+				p++;
+			}
+			exponent += negativeExponent ? -written : written;
+		}
+		value = static_cast<double>(mantissa) * std::pow(10.0, exponent);
+		if (negative)
+		{
+			value = -value;
+		}
+		return true;
+	}
+
+	bool isSeparator(char c)
+	{
+		return c == ',' || c == ' ' || c == '\t' || c == ';' || c == '\r';
+	}
+
+	// Index of each CSV column the importer knows in a row, in the order x, y, z, vx, vy, vz, mass, radius
+	const int csvFields = 8;
+	const char* const csvNames[csvFields] = { "x", "y", "z", "vx", "vy", "vz", "mass", "radius" };
+}
+
+// Gadget's default units: kpc, km/s and 1e10 solar masses (h = 1)
+ImportUnits gadgetUnits()
+{
+	return { 3.0856775814913673e13, 1e-3, 1.98847e16 };
+}
+
+// Files already in Mm, Mm/s and Rg
+ImportUnits simulationUnits()
+{
+	return { 1.0, 1.0, 1.0 };
+}
+
+// The format of a file, chosen by its extension
+ParticleFormat particleFormat(const std::string& path)
+{
+	std::string extension;
+	size_t dot = path.find_last_of('.');
+	if (dot != std::string::npos)
+	{
+		extension = path.substr(dot);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	}
+	if (extension == ".csv" || extension == ".txt")
+	{
+		return particleFormatCsv;
+	}
+	if (extension == ".bin")
+	{
+		return particleFormatColumnar;
+	}
+	return particleFormatGadget;
+}
+
+// Reads initial conditions in the format given by the extension of path
+bool importParticles(const std::string& path, const ImportUnits& units, SnapshotData& out, std::string& error)
+{
+	switch (particleFormat(path))
+	{
+	case particleFormatCsv:
+		return importCsv(path, units, out, error);
+	case particleFormatColumnar:
+		return importColumnar(path, units, out, error);
+	default:
+		return importGadget(path, units, out, error);
+	}
+}
+
+// Reads a Gadget-2 snapshot, all of its files if path ends in .0 and the header says it is split
+bool importGadget(const std::string& path, const ImportUnits& units, SnapshotData& out, std::string& error)
+{
+	size_t count;
+	int files;
+	if (!readGadgetCounts(path, count, files, error))
+	{
+		return false;
+	}
+	std::vector<std::string> paths = { path };
+	if (files > 1 && path.size() > 2 && path.compare(path.size() - 2, 2, ".0") == 0)
+	{
+		std::string base = path.substr(0, path.size() - 1);
+		for (int i = 1; i < files; i++)
+		{
+			size_t fileCount;
+			int ignored;
+			paths.push_back(base + std::to_string(i));
+			if (!readGadgetCounts(paths.back(), fileCount, ignored, error))
+			{
+				return false;
+			}
+			count += fileCount;
+		}
+	}
+
+	out.positions.resize(count * 3);
+	out.velocities.resize(count * 3);
+	out.masses.resize(count);
+	out.radii.clear();
+	out.colors.clear();
+	out.meshIds.clear();
+	size_t first = 0;
+	for (const std::string& filePath : paths)
+	{
+		size_t fileCount;
+		int ignored;
+		if (!readGadgetCounts(filePath, fileCount, ignored, error) || !readGadgetFile(filePath, units, out, first, error))
+		{
+			return false;
+		}
+		first += fileCount;
+	}
+	return true;
+}
+
+// Reads a CSV file with a header row naming its columns
+bool importCsv(const std::string& path, const ImportUnits& units, SnapshotData& out, std::string& error)
+{
+	MappedFile file(path.c_str());
+	if (!file.Valid())
+	{
+		error = "could not open " + path;
+		return false;
+	}
+	const char* begin = file.Data();
+	const char* end = begin + file.Size();
+
+	// The header maps each known name to its column
+	const char* p = begin;
+	int fieldColumn[csvFields];
+	std::fill(fieldColumn, fieldColumn + csvFields, -1);
+	int columns = 0;
+	while (p < end && *p != '\n')
+	{
+		while (p < end && isSeparator(*p))
+		{
+			p++;
+		}
+		const char* start = p;
+		while (p < end && !isSeparator(*p) && *p != '\n')
+		{
+			p++;
+		}
+		if (p == start)
+		{
+			continue;
+		}
+		std::string name(start, p);
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		for (int field = 0; field < csvFields; field++)
+		{
+			if (name == csvNames[field])
+			{
+				fieldColumn[field] = columns;
+			}
+		}
+		columns++;
+	}
+	for (int field = 0; field < 7; field++)
+	{
+		if (fieldColumn[field] < 0)
+		{
+			error = path + " has no " + csvNames[field] + " column";
+			return false;
+		}
+	}
+	bool hasRadius = fieldColumn[7] >= 0;
+	const char* body = p < end ? p + 1 : end;
+
+	// Every thread takes a slice of whole lines: count them first, then parse into the rows after the previous slices
+	int threads = std::max(omp_get_max_threads(), 1);
+	std::vector<const char*> sliceStart(threads + 1);
+	for (int t = 0; t <= threads; t++)
+	{
+		const char* cut = body + (end - body) * t / threads;
+		while (t > 0 && t < threads && cut < end && cut[-1] != '\n')
+		{
+			cut++;
+		}
+		sliceStart[t] = t == threads ? end : cut;
+	}
+	std::vector<size_t> sliceRows(threads + 1, 0);
+	#pragma omp parallel for num_threads(threads)
+	for (int t = 0; t < threads; t++)
+	{
+		size_t rows = 0;
+		for (const char* line = sliceStart[t]; line < sliceStart[t + 1];)
+		{
+			const char* next = static_cast<const char*>(std::memchr(line, '\n', sliceStart[t + 1] - line));
+			next = next != nullptr ? next + 1 : sliceStart[t + 1];
+			const char* c = line;
+			while (c < next && (isSeparator(*c) || *c == '\n'))
+			{
+				c++;
+			}
+			if (c < next && *c != '#')
+			{
+				rows++;
+			}
+			line = next;
+		}
+		sliceRows[t + 1] = rows;
+	}
+	for (int t = 0; t < threads; t++)
+	{
+		sliceRows[t + 1] += sliceRows[t];
+	}
+
+	size_t count = sliceRows[threads];
+	out.positions.resize(count * 3);
+	out.velocities.resize(count * 3);
+	out.masses.resize(count);
+	out.radii.resize(hasRadius ? count : 0);
+	out.colors.clear();
+	out.meshIds.clear();
+
+	std::vector<size_t> badLine(threads, 0);
+	#pragma omp parallel for num_threads(threads)
+	for (int t = 0; t < threads; t++)
+	{
+		size_t row = sliceRows[t];
+		double values[csvFields];
+		for (const char* line = sliceStart[t]; line < sliceStart[t + 1];)
+		{
+			const char* next = static_cast<const char*>(std::memchr(line, '\n', sliceStart[t + 1] - line));
+			const char* lineEnd = next != nullptr ? next : sliceStart[t + 1];
+			next = next != nullptr ? next + 1 : sliceStart[t + 1];
+
+			const char* c = line;
+			while (c < lineEnd && isSeparator(*c))
+			{
+				c++;
+			}
+			if (c == lineEnd || *c == '#')
+			{
+				line = next;
+				continue;
+			}
+			int column = 0;
+			bool parsed = true;
+			while (c < lineEnd && parsed)
+			{
+				double value = 0.0;
+				parsed = parseNumber(c, lineEnd, value);
+				for (int field = 0; field < csvFields; field++)
+				{
+					if (fieldColumn[field] == column)
+					{
+						values[field] = value;
+					}
+				}
+				column++;
+				while (c < lineEnd && isSeparator(*c))
+				{
+					c++;
+				}
+			}
+			if (!parsed || column < columns)
+			{
+				if (badLine[t] == 0)
+				{
+					badLine[t] = row + 2; // 1-based, after the header
+				}
+				line = next;
+				row++;
+				continue;
+			}
+			for (int axis = 0; axis < 3; axis++)
+			{
+				out.positions[3 * row + axis] = values[axis] * units.length;
+				out.velocities[3 * row + axis] = values[3 + axis] * units.velocity;
+			}
+			out.masses[row] = values[6] * units.mass;
+			if (hasRadius)
+			{
+				out.radii[row] = values[7] * units.length;
+			}
+			row++;
+			line = next;
+		}
+	}
+	for (size_t line : badLine)
+	{
+		if (line != 0)
+		{
+			error = path + ": could not read body " + std::to_string(line - 1);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Reads a body count followed by seven columns of doubles
+bool importColumnar(const std::string& path, const ImportUnits& units, SnapshotData& out, std::string& error)
+{
+	MappedFile file(path.c_str());
+	uint64_t count = 0;
+	if (!file.Valid() || file.Size() < sizeof(count))
+	{
+		error = "could not open " + path;
+		return false;
+	}
+	std::memcpy(&count, file.Data(), sizeof(count));
+	if (count > (file.Size() - sizeof(count)) / (7 * sizeof(double)) || file.Size() != sizeof(count) + count * 7 * sizeof(double))
+	{
+		error = path + " does not hold 7 columns of the body count in its header";
+		return false;
+	}
+
+	size_t n = static_cast<size_t>(count);
+	out.positions.resize(n * 3);
+	out.velocities.resize(n * 3);
+	out.masses.resize(n);
+	out.radii.clear();
+	out.colors.clear();
+	out.meshIds.clear();
+	const char* columns = file.Data() + sizeof(count);
+	#pragma omp parallel for
+	for (long long k = 0; k < static_cast<long long>(n); k++)
+	{
+		size_t i = static_cast<size_t>(k);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			out.positions[3 * i + axis] = readReal(columns, axis * n + i, true) * units.length;
+			out.velocities[3 * i + axis] = readReal(columns, (3 + axis) * n + i, true) * units.velocity;
+		}
+		out.masses[i] = readReal(columns, 6 * n + i, true) * units.mass;
+	}
+	return true;
+}
\ No newline at end of file
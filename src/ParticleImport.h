@@ -0,0 +1,47 @@
+#ifndef PARTICLE_IMPORT_CLASS_H
+#define PARTICLE_IMPORT_CLASS_H
+
+#include<string>
+
+#include"Snapshot.h"
+
+// Factors from the units of a file to the simulation's Mm, Mm/s and Rg
+struct ImportUnits
+{
+	double length;
+	double velocity;
+	double mass;
+};
+
+// Gadget's default units: kpc, km/s and 1e10 solar masses (h = 1)
+ImportUnits gadgetUnits();
+// Files already in Mm, Mm/s and Rg
+ImportUnits simulationUnits();
+
+enum ParticleFormat
+{
+	particleFormatGadget,
+	particleFormatCsv,
+	particleFormatColumnar
+};
+
+// The format of a file, chosen by its extension
+ParticleFormat particleFormat(const std::string& path);
+
+// Reads initial conditions into the position, velocity and mass columns of out (radii too when the
+// file has them; colors and meshes are left empty). Files are memory-mapped and converted by every
+// core; nothing is done per body beyond filling the columns. The format follows the extension:
+//   .csv or .txt  a header naming the columns x, y, z, vx, vy, vz, mass and optionally radius,
+//                 then one body per line, separated by commas or whitespace
+//   .bin          a little endian uint64 body count followed by the columns x, y, z, vx, vy, vz
+//                 and mass, each as count doubles (what numpy's tofile writes)
+//   anything else a Gadget-2 snapshot, format 1 or 2, single or double precision; a path ending
+//                 in .0 of a snapshot split over several files reads all of them
+// Returns false and sets error if the file could not be read.
+bool importParticles(const std::string& path, const ImportUnits& units, SnapshotData& out, std::string& error);
+
+bool importGadget(const std::string& path, const ImportUnits& units, SnapshotData& out, std::string& error);
+bool importCsv(const std::string& path, const ImportUnits& units, SnapshotData& out, std::string& error);
+bool importColumnar(const std::string& path, const ImportUnits& units, SnapshotData& out, std::string& error);
+
+#endif
\ No newline at end of file
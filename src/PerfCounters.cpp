@@ -0,0 +1,270 @@
+#include"PerfCounters.h"
+
+#include<algorithm>
+#include<atomic>
+#include<cerrno>
+#include<cstdio>
+#include<cstring>
+#include<mutex>
+
+#if defined(__linux__)
+#include<linux/perf_event.h>
+#include<sys/ioctl.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+#endif
+
+#include"Tracer.h"
+
+const char* const perfCounterNames[counterCount] = { "Cycles", "Instructions", "Cache misses", "Branch misses" };
+
+namespace
+{
+	std::atomic<bool> enabled{ false };
+	std::atomic<unsigned> supported{ 0 }; // bit per counter some thread could open
+	std::atomic<int> countingThreads{ 0 };
+
+	std::mutex totalsMutex; // guards totals and failure
+	std::vector<PhaseCounters> totals;
+	std::string failure;
+
+	void fail(const std::string& reason)
+	{
+		std::lock_guard<std::mutex> lock(totalsMutex);
+		if (failure.empty())
+		{
+			failure = reason;
+		}
+	}
+
+#if defined(__linux__)
+	const uint64_t eventConfigs[counterCount] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+
+	// One group per thread, read with a single system call. Its file descriptors close when the thread ends.
+	struct ThreadCounters
+	{
+		bool tried = false;
+		int leader = -1;
+		int fds[counterCount] = { -1, -1, -1, -1 };
+		int slots[counterCount] = { -1, -1, -1, -1 }; // position of each counter in a group read, -1 if not open
+		int opened = 0;
+
+		~ThreadCounters()
+		{
+			for (int fd : fds)
+			{
+				if (fd >= 0)
+				{
+					close(fd);
+				}
+			}
+			if (leader >= 0)
+			{
+				countingThreads--;
+			}
+		}
+
+		bool Open()
+		{
+			tried = true;
+			int firstError = 0;
+			for (int counter = 0; counter < counterCount; counter++)
+			{
+				perf_event_attr attr;
+				std::memset(&attr, 0, sizeof(attr));
+				attr.size = sizeof(attr);
+				attr.type = PERF_TYPE_HARDWARE;
+				attr.config = eventConfigs[counter];
+				attr.disabled = leader < 0 ? 1 : 0; // the group starts when the leader is enabled
+				attr.exclude_kernel = 1; // allowed at perf_event_paranoid 2, and the kernel is not ours to tune
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+				int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+				if (fd < 0)
+				{
+					firstError = firstError != 0 ? firstError : errno;
+					continue;
+				}
+				fds[counter] = fd;
+				slots[counter] = opened++;
+				if (leader < 0)
+				{
+					leader = fd;
+				}
+				supported |= 1u << counter;
+			}
+			if (leader < 0)
+			{
+				fail(describe(firstError));
+				return false;
+			}
+			ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+			countingThreads++;
+			return true;
+		}
+
+		bool Read(uint64_t values[counterCount])
+		{
+			if (!tried && !Open())
+			{
+				return false;
+			}
+			if (leader < 0)
+			{
+				return false;
+			}
+			uint64_t data[3 + counterCount];
+			ssize_t bytes = read(leader, data, sizeof(data));
+			if (bytes < static_cast<ssize_t>(3 * sizeof(uint64_t)))
+			{
+				return false;
+			}
+			// While other groups share the hardware, each is counted part of the time; scale up to the whole time
+			double scale = data[2] > 0 && data[2] < data[1] ? static_cast<double>(data[1]) / data[2] : 1.0;
+			for (int counter = 0; counter < counterCount; counter++)
+			{
+				values[counter] = slots[counter] >= 0 && static_cast<uint64_t>(slots[counter]) < data[0]
+					? static_cast<uint64_t>(data[3 + slots[counter]] * scale) : 0;
+			}
+			return true;
+		}
+
+		static std::string describe(int error)
+		{
+			std::string reason = std::string("perf_event_open failed: ") + std::strerror(error);
+			if (error == EACCES || error == EPERM)
+			{
+				FILE* file = std::fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+				int paranoid = 0;
+				if (file != nullptr && std::fscanf(file, "%d", &paranoid) == 1)
+				{
+					reason += " (perf_event_paranoid is " + std::to_string(paranoid) + ", counting needs 2 or lower, or CAP_PERFMON)";
+				}
+				if (file != nullptr)
+				{
+					std::fclose(file);
+				}
+			}
+			else if (error == ENOENT || error == EOPNOTSUPP || error == ENODEV)
+			{
+				reason += " (no hardware events, e.g. inside a VM without a virtual PMU)";
+			}
+			return reason;
+		}
+	};
+
+	thread_local ThreadCounters threadCounters;
+#endif
+}
+
+// Turns counting on or off
+void PerfCounters::SetEnabled(bool on)
+{
+	enabled.store(on, std::memory_order_relaxed);
+}
+
+bool PerfCounters::Enabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+// Whether the calling thread has working counters
+bool PerfCounters::Available()
+{
+	uint64_t values[counterCount];
+	return Read(values);
+}
+
+// Whether any thread could count this event
+bool PerfCounters::Supported(PerfCounter counter)
+{
+	return (supported.load(std::memory_order_relaxed) & (1u << counter)) != 0;
+}
+
+// What went wrong when counters could not be opened, or how many threads are counting
+std::string PerfCounters::Status()
+{
+#if defined(__linux__)
+	int threads = countingThreads.load();
+	std::lock_guard<std::mutex> lock(totalsMutex);
+	if (threads > 0)
+	{
+		return "Counting on " + std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+	}
+	return failure.empty() ? "Not started" : failure;
+#else
+	return "Hardware counters need Linux perf events";
+#endif
+}
+
+// Current totals of the calling thread's counters
+bool PerfCounters::Read(uint64_t values[counterCount])
+{
+#if defined(__linux__)
+	return threadCounters.Read(values);
+#else
+	(void)values;
+	return false;
+#endif
+}
+
+// Adds the events of one finished zone to its phase on the calling thread
+void PerfCounters::Add(const char* phase, const uint64_t values[counterCount])
+{
+	uint32_t thread = Tracer::CurrentThread();
+	std::lock_guard<std::mutex> lock(totalsMutex);
+	for (PhaseCounters& total : totals)
+	{
+		if (total.phase == phase && total.thread == thread)
+		{
+			total.zones++;
+			for (int counter = 0; counter < counterCount; counter++)
+			{
+				total.values[counter] += values[counter];
+			}
+			return;
+		}
+	}
+	PhaseCounters total = { phase, thread, 1, {} };
+	std::copy(values, values + counterCount, total.values);
+	totals.push_back(total);
+}
+
+// Every phase and thread counted since the last reset
+std::vector<PhaseCounters> PerfCounters::Totals()
+{
+	std::lock_guard<std::mutex> lock(totalsMutex);
+	return totals;
+}
+
+void PerfCounters::Reset()
+{
+	std::lock_guard<std::mutex> lock(totalsMutex);
+	totals.clear();
+}
+
+// Reads the counters at the start of the zone
+CounterZone::CounterZone(const char* phase)
+	: phase(phase), counting(PerfCounters::Enabled() && PerfCounters::Read(start))
+{
+}
+
+// Adds what happened since the start of the zone to its phase
+CounterZone::~CounterZone()
+{
+	uint64_t end[counterCount];
+	if (counting && PerfCounters::Read(end))
+	{
+		for (int counter = 0; counter < counterCount; counter++)
+		{
+			end[counter] = end[counter] >= start[counter] ? end[counter] - start[counter] : 0;
+		}
+		PerfCounters::Add(phase, end);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef PERF_COUNTERS_CLASS_H
+#define PERF_COUNTERS_CLASS_H
+
+#include<cstdint>
+#include<string>
+#include<vector>
+
+// Hardware events counted for each phase
+enum PerfCounter
+{
+	counterCycles,
+	counterInstructions,
+	counterCacheMisses,
+	counterBranchMisses,
+	counterCount
+};
+
+extern const char* const perfCounterNames[counterCount];
+
+// Events one phase caused on one thread since the last reset
+struct PhaseCounters
+{
+	const char* phase;
+	uint32_t thread; // Tracer thread id
+	uint64_t zones;
+	uint64_t values[counterCount];
+};
+
+// Counts CPU events with Linux perf events, per thread: every thread opens its own counters the first time
+// it reads them. Counting needs a kernel that allows it to unprivileged users (perf_event_paranoid of 2
+// or lower) and hardware that exposes the events, which many VMs do not; without them reads fail, zones
+// count nothing and Status says why. Counters the CPU lacks are left out and reported as unsupported.
+class PerfCounters
+{
+public:
+	// Turns counting on or off; off, zones do not touch the counters at all
+	static void SetEnabled(bool enabled);
+	static bool Enabled();
+
+	// Whether the calling thread has working counters, opening them if it did not try yet
+	static bool Available();
+	// Whether any thread could count this event
+	static bool Supported(PerfCounter counter);
+	// What went wrong when counters could not be opened, or how many threads are counting
+	static std::string Status();
+
+	// Current totals of the calling thread's counters; false if it has none
+	static bool Read(uint64_t values[counterCount]);
+	// Adds the events of one finished zone to its phase on the calling thread
+	static void Add(const char* phase, const uint64_t values[counterCount]);
+
+	// Every phase and thread counted since the last reset, in order of first appearance
+	static std::vector<PhaseCounters> Totals();
+	static void Reset();
+};
+
+// Counts the events between its construction and destruction towards a phase on the current thread
+class CounterZone
+{
+public:
+	explicit CounterZone(const char* phase);
+	~CounterZone();
+
+	CounterZone(const CounterZone&) = delete;
+	CounterZone& operator=(const CounterZone&) = delete;
+
+private:
+	const char* phase;
+	uint64_t start[counterCount];
+	bool counting;
+};
+
+#endif
\ No newline at end of file
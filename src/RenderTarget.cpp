@@ -0,0 +1,118 @@
+#include"RenderTarget.h"
+
+#include<algorithm>
+#include<iostream>
+
+// Creates the framebuffer objects; attachments are created by the first Resize
+RenderTarget::RenderTarget()
+{
+	glGenFramebuffers(1, &framebuffer);
+	glGenFramebuffers(1, &resolveFramebuffer);
+	glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+}
+
+// Deletes the framebuffers and their attachments
+RenderTarget::~RenderTarget()
+{
+	Delete();
+}
+
+// Recreates the attachments if the size or sample count changed; samples is clamped to what the driver supports
+void RenderTarget::Resize(int newWidth, int newHeight, int newSamples)
+{
+	newWidth = std::max(newWidth, 1);
+	newHeight = std::max(newHeight, 1);
+	newSamples = std::clamp(newSamples, 0, static_cast<int>(maxSamples));
+	if (newWidth == width && newHeight == height && newSamples == samples)
+	{
+		return;
+	}
+	DeleteAttachments();
+	width = newWidth;
+	height = newHeight;
+	samples = newSamples;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "RenderTarget framebuffer is incomplete at " << width << "x" << height << " with " << samples << " samples" << std::endl;
+	}
+
+	if (samples > 0)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, resolveFramebuffer);
+		glGenRenderbuffers(1, &resolveBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, resolveBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveBuffer);
+	}
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+// Binds the framebuffer and sets the viewport to cover it
+void RenderTarget::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+}
+
+// Resolves the samples and stretches the image over the window framebuffer, leaving it bound
+void RenderTarget::BlitToScreen(int windowWidth, int windowHeight)
+{
+	GLuint source = framebuffer;
+	if (samples > 0)
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveFramebuffer);
+		glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		source = resolveFramebuffer;
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	GLenum filter = width == windowWidth && height == windowHeight ? GL_NEAREST : GL_LINEAR;
+	glBlitFramebuffer(0, 0, width, height, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, filter);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, windowWidth, windowHeight);
+}
+
+// Deletes the framebuffers and their attachments
+void RenderTarget::Delete()
+{
+	DeleteAttachments();
+	if (framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &framebuffer);
+		framebuffer = 0;
+	}
+	if (resolveFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &resolveFramebuffer);
+		resolveFramebuffer = 0;
+	}
+}
+
+// Deletes the attachments but keeps the framebuffer objects
+void RenderTarget::DeleteAttachments()
+{
+	GLuint buffers[] = { colorBuffer, depthBuffer, resolveBuffer };
+	for (GLuint buffer : buffers)
+	{
+		if (buffer != 0)
+		{
+			glDeleteRenderbuffers(1, &buffer);
+		}
+	}
+	colorBuffer = 0;
+	depthBuffer = 0;
+	resolveBuffer = 0;
+	samples = -1;
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef RENDER_TARGET_CLASS_H
+#define RENDER_TARGET_CLASS_H
+
+#include<glad/glad.h>
+
+// Offscreen framebuffer with multisampled color and depth that the scene is rendered into,
+// then resolved and stretched onto the window. Its size and sample count can change every
+// frame, which is what dynamic resolution scaling needs.
+class RenderTarget
+{
+public:
+	// Creates the framebuffer objects; attachments are created by the first Resize
+	RenderTarget();
+	// Deletes the framebuffers and their attachments
+	~RenderTarget();
+
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget& operator=(const RenderTarget&) = delete;
+
+	// Recreates the attachments if the size or sample count changed; samples is clamped to what the driver supports
+	void Resize(int width, int height, int samples);
+	// Binds the framebuffer and sets the viewport to cover it
+	void Bind();
+	// Resolves the samples and stretches the image over the window framebuffer, leaving it bound
+	void BlitToScreen(int windowWidth, int windowHeight);
+
+	int Width() const { return width; }
+	int Height() const { return height; }
+	int Samples() const { return samples; }
+
+	// Deletes the framebuffers and their attachments
+	void Delete();
+
+private:
+	// Deletes the attachments but keeps the framebuffer objects
+	void DeleteAttachments();
+
+	GLuint framebuffer = 0;
+	GLuint colorBuffer = 0;
+	GLuint depthBuffer = 0;
+	// Multisampled images cannot be scaled by a blit, so they are resolved at their own size first
+	GLuint resolveFramebuffer = 0;
+	GLuint resolveBuffer = 0;
+	int width = 0;
+	int height = 0;
+	int samples = -1;
+	GLint maxSamples = 0;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,347 @@
+#include"RewindBuffer.h"
+
+#include<cstring>
+
+#include"Compression.h"
+#include"Tracer.h"
+
+namespace
+{
+	// Raw bytes of each SnapshotData column, in a fixed order
+	struct ColumnBytes
+	{
+		const void* data;
+		size_t bytes;
+	};
+
+	void columnsOf(const SnapshotData& state, ColumnBytes (&columns)[6])
+	{
+		columns[0] = { state.positions.data(), state.positions.size() * sizeof(double) };
+		columns[1] = { state.velocities.data(), state.velocities.size() * sizeof(double) };
+		columns[2] = { state.masses.data(), state.masses.size() * sizeof(double) };
+		columns[3] = { state.radii.data(), state.radii.size() * sizeof(double) };
+		columns[4] = { state.colors.data(), state.colors.size() * sizeof(float) };
+		columns[5] = { state.meshIds.data(), state.meshIds.size() * sizeof(int32_t) };
+	}
+
+	void* mutableColumn(SnapshotData& state, int column)
+	{
+		switch (column)
+		{
+		case 0: return state.positions.data();
+		case 1: return state.velocities.data();
+		case 2: return state.masses.data();
+		case 3: return state.radii.data();
+		case 4: return state.colors.data();
+		default: return state.meshIds.data();
+		}
+	}
+
+	// Columns of floats and ints are packed into whole words, the last one padded with zeros
+	size_t wordCount(size_t bytes)
+	{
+		return (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+	}
+}
+
+// Starts the compression thread
+RewindBuffer::RewindBuffer(size_t memoryLimit)
+	: memoryLimit(memoryLimit)
+{
+	worker = std::thread(&RewindBuffer::WorkerLoop, this);
+}
+
+// Stops the compression thread
+RewindBuffer::~RewindBuffer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+// Whether a state can be handed over now
+bool RewindBuffer::Ready() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return !hasPending && !encoding;
+}
+
+// Compresses state in the background and appends it to the timeline
+void RewindBuffer::Submit(std::shared_ptr<const SnapshotData> state)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending = std::move(state);
+		hasPending = true;
+	}
+	wake.notify_one();
+}
+
+// Number of states on the timeline
+size_t RewindBuffer::Count() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.size();
+}
+
+// Simulated time of a state on the timeline
+double RewindBuffer::Time(size_t index) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return index < entries.size() ? entries[index]->simulationTime : 0.0;
+}
+
+// Decodes the state at index into out; the timeline branches from it
+bool RewindBuffer::Restore(size_t index, SnapshotData& out)
+{
+	std::shared_ptr<Entry> entry;
+	std::shared_ptr<Entry> keyframe;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (index >= entries.size())
+		{
+			return false;
+		}
+		entry = entries[index];
+		size_t key = index;
+		while (!entries[key]->keyframe)
+		{
+			key--; // eviction always removes a keyframe together with its states, so one is found
+		}
+		keyframe = entries[key];
+		branchId = entry->id;
+		// A state captured before the restore belongs to the old branch
+		pending.reset();
+		hasPending = false;
+		generation++;
+	}
+
+	// Entries are immutable once appended, so decoding happens without holding the lock
+	out.simulationTime = entry->simulationTime;
+	out.parameters = entry->parameters;
+	out.Resize(static_cast<size_t>(entry->bodyCount));
+	ColumnBytes columns[columnCount];
+	columnsOf(out, columns);
+	std::vector<uint64_t> words;
+	for (int column = 0; column < columnCount; column++)
+	{
+		if (!DecodeColumn(*keyframe, column, words) || (entry != keyframe && !DecodeColumn(*entry, column, words)))
+		{
+			return false;
+		}
+		std::memcpy(mutableColumn(out, column), words.data(), columns[column].bytes);
+	}
+	return true;
+}
+
+// Forgets every state
+void RewindBuffer::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	memoryUsed = 0;
+	keyLost = true;
+	branchId = 0;
+	pending.reset();
+	hasPending = false;
+	generation++;
+}
+
+size_t RewindBuffer::MemoryUsed() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return memoryUsed;
+}
+
+size_t RewindBuffer::MemoryLimit() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return memoryLimit;
+}
+
+// Changes the cap; older states are evicted with the next submission if the timeline is over it
+void RewindBuffer::SetMemoryLimit(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	memoryLimit = bytes;
+}
+
+// Compresses submitted states until the buffer is destroyed
+void RewindBuffer::WorkerLoop()
+{
+	Tracer::NameThread("Rewind buffer");
+	std::shared_ptr<const SnapshotData> state;
+	while (true)
+	{
+		uint64_t taken;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || hasPending; });
+			if (stopping)
+			{
+				return;
+			}
+			std::swap(state, pending);
+			hasPending = false;
+			encoding = true;
+			taken = generation;
+		}
+
+		TraceZone zone("Compress rewind state");
+		std::shared_ptr<Entry> entry = Encode(*state);
+		state.reset();
+		zone.End();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (generation == taken)
+		{
+			Append(std::move(entry));
+		}
+		else
+		{
+			// The timeline was restored or cleared meanwhile; a keyframe encoded here was never appended
+			keyLost = true;
+		}
+		encoding = false;
+	}
+}
+
+// Compresses one state, as a keyframe or against the current one
+std::shared_ptr<RewindBuffer::Entry> RewindBuffer::Encode(const SnapshotData& state)
+{
+	bool keyframe;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		// A restore may have cut the timeline before the current keyframe
+		bool keyCut = branchId != 0 && branchId < keyId;
+		keyframe = keyLost || keyCut || state.BodyCount() != keyBodyCount || sinceKeyframe >= keyframeInterval;
+		keyLost = false;
+	}
+
+	auto entry = std::make_shared<Entry>();
+	entry->keyframe = keyframe;
+	entry->simulationTime = state.simulationTime;
+	entry->parameters = state.parameters;
+	entry->bodyCount = state.BodyCount();
+
+	ColumnBytes columns[columnCount];
+	columnsOf(state, columns);
+	for (int column = 0; column < columnCount; column++)
+	{
+		size_t words = wordCount(columns[column].bytes);
+		scratch.assign(words, 0);
+		std::memcpy(scratch.data(), columns[column].data, columns[column].bytes);
+		if (keyframe)
+		{
+			keyWords[column] = scratch;
+		}
+		else
+		{
+			// The difference of the bit patterns is small when a value moved a little relative to its size,
+			// and zero when it did not change
+			for (size_t i = 0; i < words; i++)
+			{
+				scratch[i] = zigzagEncode(static_cast<int64_t>(scratch[i] - keyWords[column][i]));
+			}
+		}
+		size_t before = entry->data.size();
+		compressWords(scratch.data(), words, entry->data);
+		entry->columnBytes[column] = static_cast<uint32_t>(entry->data.size() - before);
+	}
+	entry->data.shrink_to_fit();
+
+	sinceKeyframe = keyframe ? 0 : sinceKeyframe + 1;
+	if (keyframe)
+	{
+		keyBodyCount = entry->bodyCount;
+	}
+	return entry;
+}
+
+// Adds a compressed state, drops branched-off states and evicts the oldest ones over the limit; mutex held
+void RewindBuffer::Append(std::shared_ptr<Entry> entry)
+{
+	if (branchId != 0)
+	{
+		while (!entries.empty() && entries.back()->id > branchId)
+		{
+			memoryUsed -= entries.back()->Memory();
+			entries.pop_back();
+		}
+		// Cutting off the current keyframe orphans a delta stored against it
+		bool keyCut = keyId > branchId;
+		branchId = 0;
+		if (keyCut)
+		{
+			keyLost = true;
+			if (!entry->keyframe)
+			{
+				return;
+			}
+		}
+	}
+
+	entry->id = nextId++;
+	if (entry->keyframe)
+	{
+		keyId = entry->id;
+	}
+	memoryUsed += entry->Memory();
+	entries.push_back(std::move(entry));
+
+	// Evict whole groups, a keyframe with the states stored against it, but never the newest group
+	while (memoryUsed > memoryLimit)
+	{
+		size_t groupEnd = 1;
+		while (groupEnd < entries.size() && !entries[groupEnd]->keyframe)
+		{
+			groupEnd++;
+		}
+		if (groupEnd == entries.size())
+		{
+			break;
+		}
+		for (size_t i = 0; i < groupEnd; i++)
+		{
+			memoryUsed -= entries.front()->Memory();
+			entries.pop_front();
+		}
+	}
+}
+
+// Decodes one column of an entry into words, added onto what words already holds for a delta
+bool RewindBuffer::DecodeColumn(const Entry& entry, int column, std::vector<uint64_t>& words)
+{
+	size_t offset = 0;
+	for (int i = 0; i < column; i++)
+	{
+		offset += entry.columnBytes[i];
+	}
+	static const size_t bytesPerBody[columnCount] = { 3 * sizeof(double), 3 * sizeof(double), sizeof(double), sizeof(double), 3 * sizeof(float), sizeof(int32_t) };
+	size_t count = wordCount(static_cast<size_t>(entry.bodyCount) * bytesPerBody[column]);
+
+	std::vector<uint64_t> decoded(count);
+	if (!decompressWords(entry.data.data() + offset, entry.columnBytes[column], decoded.data(), count))
+	{
+		return false;
+	}
+	if (entry.keyframe)
+	{
+		words.swap(decoded);
+	}
+	else
+	{
+		if (words.size() != count)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			words[i] += static_cast<uint64_t>(zigzagDecode(decoded[i]));
+		}
+	}
+	return true;
+}
\ No newline at end of file
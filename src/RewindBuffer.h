@@ -0,0 +1,108 @@
+#ifndef REWIND_BUFFER_CLASS_H
+#define REWIND_BUFFER_CLASS_H
+
+#include<condition_variable>
+#include<cstddef>
+#include<cstdint>
+#include<deque>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#include"Snapshot.h"
+
+// Timeline of recent simulation states kept in memory so a run can be rewound in milliseconds.
+// States are compressed losslessly on a worker thread: a keyframe stores every column of a
+// SnapshotData, the states after it store the difference of their bit patterns to the keyframe.
+// Values that barely moved give small differences and unchanged ones give zero, which compressWords
+// stores in a few bytes. Restoring decodes at most two states.
+// When the memory limit is reached, the oldest keyframe goes together with the states that need it.
+class RewindBuffer
+{
+public:
+	// Starts the compression thread
+	explicit RewindBuffer(size_t memoryLimit = 256 * 1024 * 1024);
+	// Stops the compression thread
+	~RewindBuffer();
+
+	RewindBuffer(const RewindBuffer&) = delete;
+	RewindBuffer& operator=(const RewindBuffer&) = delete;
+
+	// Whether a state can be handed over now; false while the previous one is still being compressed
+	bool Ready() const;
+	// Compresses state in the background and appends it to the timeline. The state is only read, so the same
+	// capture can be handed to other readers such as the body editor's query.
+	void Submit(std::shared_ptr<const SnapshotData> state);
+
+	// Number of states on the timeline and their simulated times
+	size_t Count() const;
+	double Time(size_t index) const;
+	// Decodes the state at index into out. States after it are dropped as soon as the next one is
+	// submitted, so the timeline branches from the restored state; a state submitted before the restore is discarded.
+	bool Restore(size_t index, SnapshotData& out);
+	// Forgets every state
+	void Clear();
+
+	// Memory used by compressed states and the cap it is held to
+	size_t MemoryUsed() const;
+	size_t MemoryLimit() const;
+	void SetMemoryLimit(size_t bytes);
+
+	// States stored against the same keyframe before a new keyframe is taken
+	static const int keyframeInterval = 32;
+
+private:
+	// Number of column arrays in a SnapshotData
+	static const int columnCount = 6;
+
+	struct Entry
+	{
+		uint64_t id;
+		bool keyframe;
+		double simulationTime;
+		SimulationParameters parameters;
+		uint64_t bodyCount;
+		uint32_t columnBytes[columnCount];
+		std::vector<uint8_t> data;
+
+		size_t Memory() const { return sizeof(Entry) + data.capacity(); }
+	};
+
+	// Compresses submitted states until the buffer is destroyed
+	void WorkerLoop();
+	// Compresses one state, as a keyframe or against the current one
+	std::shared_ptr<Entry> Encode(const SnapshotData& state);
+	// Adds a compressed state, drops branched-off states and evicts the oldest ones over the limit; mutex held
+	void Append(std::shared_ptr<Entry> entry);
+	// Decodes one column of an entry into words, added onto what words already holds for a delta
+	static bool DecodeColumn(const Entry& entry, int column, std::vector<uint64_t>& words);
+
+	// Only used by the worker thread
+	std::vector<uint64_t> keyWords[columnCount];
+	uint64_t keyId = 0;
+	uint64_t keyBodyCount = 0;
+	int sinceKeyframe = 0;
+	std::vector<uint64_t> scratch;
+
+	// Shared with the worker
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<std::shared_ptr<Entry>> entries;
+	size_t memoryUsed = 0;
+	size_t memoryLimit;
+	uint64_t nextId = 1;
+	// Set when the current keyframe was evicted or cut off, so the worker starts a new one
+	bool keyLost = true;
+	// Id of the restored state; newer states are dropped when the next one arrives
+	uint64_t branchId = 0;
+	// Bumped by Restore and Clear; a state taken for encoding under an older generation is dropped
+	uint64_t generation = 0;
+	std::shared_ptr<const SnapshotData> pending;
+	bool hasPending = false;
+	bool encoding = false;
+	bool stopping = false;
+	std::thread worker;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,370 @@
+#include"Skybox.h"
+
+#include<algorithm>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<filesystem>
+#include<fstream>
+#include<iostream>
+#include<random>
+#include<stb/stb_image.h>
+
+#include"Tracer.h"
+
+namespace
+{
+	// 36 vertices of a unit cube, wound to be seen from the inside
+	const GLfloat skyboxVertices[] =
+	{
+		-1.0f,  1.0f, -1.0f,  -1.0f, -1.0f, -1.0f,   1.0f, -1.0f, -1.0f,
+		 1.0f, -1.0f, -1.0f,   1.0f,  1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,
+
+		-1.0f, -1.0f,  1.0f,  -1.0f, -1.0f, -1.0f,  -1.0f,  1.0f, -1.0f,
+		-1.0f,  1.0f, -1.0f,  -1.0f,  1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,
+
+		 1.0f, -1.0f, -1.0f,   1.0f, -1.0f,  1.0f,   1.0f,  1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,   1.0f,  1.0f, -1.0f,   1.0f, -1.0f, -1.0f,
+
+		-1.0f, -1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,   1.0f,  1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,   1.0f, -1.0f,  1.0f,  -1.0f, -1.0f,  1.0f,
+
+		-1.0f,  1.0f, -1.0f,   1.0f,  1.0f, -1.0f,   1.0f,  1.0f,  1.0f,
+		 1.0f,  1.0f,  1.0f,  -1.0f,  1.0f,  1.0f,  -1.0f,  1.0f, -1.0f,
+
+		-1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f,   1.0f, -1.0f, -1.0f,
+		 1.0f, -1.0f, -1.0f,  -1.0f, -1.0f,  1.0f,   1.0f, -1.0f,  1.0f
+	};
+
+	const char starfieldMagic[4] = { 'J', 'S', 'K', 'Y' };
+	const uint32_t starfieldVersion = 1;
+
+	struct StarfieldHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t faceSize;
+		uint32_t starCount;
+		uint32_t seed;
+		uint32_t reserved;
+	};
+
+	// Finds the cube face a direction points at and its texel, following the GL cubemap conventions
+	void directionToFace(const glm::vec3& d, int faceSize, int& face, int& x, int& y)
+	{
+		glm::vec3 a(std::fabs(d.x), std::fabs(d.y), std::fabs(d.z));
+		float sc, tc, ma;
+		if (a.x >= a.y && a.x >= a.z)
+		{
+			face = d.x > 0.0f ? 0 : 1;
+			sc = d.x > 0.0f ? -d.z : d.z;
+			tc = -d.y;
+			ma = a.x;
+		}
+		else if (a.y >= a.z)
+		{
+			face = d.y > 0.0f ? 2 : 3;
+			sc = d.x;
+			tc = d.y > 0.0f ? d.z : -d.z;
+			ma = a.y;
+		}
+		else
+		{
+			face = d.z > 0.0f ? 4 : 5;
+			sc = d.z > 0.0f ? d.x : -d.x;
+			tc = -d.y;
+			ma = a.z;
+		}
+		float s = (sc / ma + 1.0f) * 0.5f;
+		float t = (tc / ma + 1.0f) * 0.5f;
+		x = std::min(static_cast<int>(s * faceSize), faceSize - 1);
+		y = std::min(static_cast<int>(t * faceSize), faceSize - 1);
+	}
+
+	// Adds light to one texel, saturating at white
+	void addLight(std::vector<unsigned char>& face, int faceSize, int x, int y, const glm::vec3& light)
+	{
+		if (x < 0 || y < 0 || x >= faceSize || y >= faceSize)
+		{
+			return;
+		}
+		unsigned char* texel = &face[(static_cast<size_t>(y) * faceSize + x) * 4];
+		for (int c = 0; c < 3; c++)
+		{
+			texel[c] = static_cast<unsigned char>(std::min(255.0f, texel[c] + light[c] * 255.0f));
+		}
+	}
+
+	// Reads a baked starfield with a single read; fails if it is missing or was baked with other settings
+	bool readStarfield(const std::string& path, int faceSize, int starCount, unsigned int seed, std::vector<unsigned char> faces[6])
+	{
+		std::ifstream in(path, std::ios::binary | std::ios::ate);
+		if (!in)
+		{
+			return false;
+		}
+		size_t faceBytes = static_cast<size_t>(faceSize) * faceSize * 4;
+		std::streamsize size = in.tellg();
+		if (size != static_cast<std::streamsize>(sizeof(StarfieldHeader) + 6 * faceBytes))
+		{
+			return false;
+		}
+		std::vector<char> contents(static_cast<size_t>(size));
+		in.seekg(0, std::ios::beg);
+		if (!in.read(contents.data(), size))
+		{
+			return false;
+		}
+
+		StarfieldHeader header;
+		std::memcpy(&header, contents.data(), sizeof(header));
+		if (std::memcmp(header.magic, starfieldMagic, sizeof(starfieldMagic)) != 0 || header.version != starfieldVersion
+			|| header.faceSize != static_cast<uint32_t>(faceSize) || header.starCount != static_cast<uint32_t>(starCount) || header.seed != seed)
+		{
+			return false;
+		}
+		for (int i = 0; i < 6; i++)
+		{
+			const char* source = contents.data() + sizeof(header) + i * faceBytes;
+			faces[i].assign(source, source + faceBytes);
+		}
+		return true;
+	}
+
+	// Writes a baked starfield through a temporary file so a crash never leaves a torn file behind
+	void writeStarfield(const std::string& path, int faceSize, int starCount, unsigned int seed, const std::vector<unsigned char> faces[6])
+	{
+		StarfieldHeader header = {};
+		std::memcpy(header.magic, starfieldMagic, sizeof(starfieldMagic));
+		header.version = starfieldVersion;
+		header.faceSize = static_cast<uint32_t>(faceSize);
+		header.starCount = static_cast<uint32_t>(starCount);
+		header.seed = seed;
+
+		std::string temporaryPath = path + ".tmp";
+		{
+			std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			for (int i = 0; i < 6; i++)
+			{
+				out.write(reinterpret_cast<const char*>(faces[i].data()), faces[i].size());
+			}
+			if (!out)
+			{
+				std::cout << "Skybox could not write starfield cache: " << path << std::endl;
+				return;
+			}
+		}
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, path, error);
+	}
+}
+
+// Renders a starfield into six RGBA8 cube faces; returns false if stop became true before it finished
+bool generateStarfield(int faceSize, int starCount, unsigned int seed, std::vector<unsigned char> faces[6], const std::atomic<bool>& stop)
+{
+	// Same dark teal as the clear color, so toggling the skybox does not change the mood
+	for (int i = 0; i < 6; i++)
+	{
+		faces[i].resize(static_cast<size_t>(faceSize) * faceSize * 4);
+		for (size_t texel = 0; texel < faces[i].size(); texel += 4)
+		{
+			faces[i][texel + 0] = 0;
+			faces[i][texel + 1] = 5;
+			faces[i][texel + 2] = 5;
+			faces[i][texel + 3] = 255;
+		}
+	}
+
+	std::mt19937 engine(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const glm::vec3 hot(0.75f, 0.85f, 1.0f);
+	const glm::vec3 cool(1.0f, 0.8f, 0.6f);
+	for (int star = 0; star < starCount; star++)
+	{
+		if ((star & 4095) == 0 && stop)
+		{
+			return false;
+		}
+		// Uniform direction on the sphere
+		float z = unit(engine) * 2.0f - 1.0f;
+		float phi = unit(engine) * 6.28318531f;
+		float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+		glm::vec3 direction(r * std::cos(phi), r * std::sin(phi), z);
+
+		// Most stars are faint; a steep power law leaves a few bright ones
+		float brightness = 0.15f + 0.85f * std::pow(unit(engine), 12.0f);
+		glm::vec3 light = glm::mix(cool, hot, unit(engine)) * brightness;
+
+		int face, x, y;
+		directionToFace(direction, faceSize, face, x, y);
+		addLight(faces[face], faceSize, x, y, light);
+		// Bright stars bleed into their neighbours
+		if (brightness > 0.5f)
+		{
+			glm::vec3 halo = light * 0.35f;
+			addLight(faces[face], faceSize, x - 1, y, halo);
+			addLight(faces[face], faceSize, x + 1, y, halo);
+			addLight(faces[face], faceSize, x, y - 1, halo);
+			addLight(faces[face], faceSize, x, y + 1, halo);
+		}
+	}
+	return true;
+}
+
+// Creates the cube geometry and an empty cubemap; the GL context must be current
+Skybox::Skybox()
+	: vbo(const_cast<GLfloat*>(skyboxVertices), sizeof(skyboxVertices))
+{
+	vao.Bind();
+	vao.LinkAttrib(vbo, 0, 3, GL_FLOAT, 3 * sizeof(float), (void*)0);
+	vao.Unbind();
+
+	glGenTextures(1, &cubemap);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+// Stops the loader and deletes the GL objects
+Skybox::~Skybox()
+{
+	Delete();
+}
+
+// Decodes six image files in the order +X, -X, +Y, -Y, +Z, -Z in the background
+void Skybox::LoadFaces(const std::array<std::string, 6>& paths)
+{
+	Restart();
+	loader = std::thread([this, paths]() {
+		Tracer::NameThread("Skybox loader");
+		TraceZone zone("Load skybox faces");
+		for (int i = 0; i < 6 && !stopping; i++)
+		{
+			int width, height, channels;
+			unsigned char* pixels = stbi_load(paths[i].c_str(), &width, &height, &channels, 4);
+			if (pixels == nullptr || width != height)
+			{
+				std::cout << "Skybox could not load a square face from: " << paths[i] << std::endl;
+				stbi_image_free(pixels);
+				failed = true;
+				return;
+			}
+			Face face;
+			face.index = i;
+			face.size = width;
+			face.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+			stbi_image_free(pixels);
+			Publish(std::move(face));
+		}
+	});
+}
+
+// Generates a procedural starfield in the background, or reads it from cachePath if it was baked before
+void Skybox::LoadStarfield(const std::string& cachePath, int faceSize, int starCount, unsigned int seed)
+{
+	Restart();
+	loader = std::thread([this, cachePath, faceSize, starCount, seed]() {
+		Tracer::NameThread("Skybox loader");
+		TraceZone zone("Generate starfield");
+		std::vector<unsigned char> faces[6];
+		if (!readStarfield(cachePath, faceSize, starCount, seed, faces))
+		{
+			if (!generateStarfield(faceSize, starCount, seed, faces, stopping))
+			{
+				return;
+			}
+			writeStarfield(cachePath, faceSize, starCount, seed, faces);
+		}
+		for (int i = 0; i < 6; i++)
+		{
+			Publish({ i, faceSize, std::move(faces[i]) });
+		}
+	});
+}
+
+// Uploads at most one finished face; call once per frame on the GL thread
+void Skybox::Update()
+{
+	Face face;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (finished.empty())
+		{
+			return;
+		}
+		face = std::move(finished.front());
+		finished.pop_front();
+	}
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+	glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face.index, 0, GL_RGBA8, face.size, face.size, 0, GL_RGBA, GL_UNSIGNED_BYTE, face.pixels.data());
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	facesUploaded++;
+}
+
+// Draws the skybox with the rotation of view only; call after the opaque passes and before the blended ones
+void Skybox::Draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection)
+{
+	if (!Ready())
+	{
+		return;
+	}
+	// The vertex shader puts every vertex on the far plane, so LEQUAL passes only where nothing was drawn
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_FALSE);
+	shader.Activate();
+	shader.setMat4("view", glm::mat4(glm::mat3(view)));
+	shader.setMat4("projection", projection);
+	shader.setInt("skybox", 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+	vao.Bind();
+	glDrawArrays(GL_TRIANGLES, 0, 36);
+	vao.Unbind();
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+}
+
+// Stops the loader and deletes the GL objects
+void Skybox::Delete()
+{
+	stopping = true;
+	if (loader.joinable())
+	{
+		loader.join();
+	}
+	finished.clear();
+	if (cubemap != 0)
+	{
+		glDeleteTextures(1, &cubemap);
+		cubemap = 0;
+	}
+	vao.Delete();
+	vbo.Delete();
+}
+
+// Waits for any previous load and clears the cubemap before a new one starts
+void Skybox::Restart()
+{
+	stopping = true;
+	if (loader.joinable())
+	{
+		loader.join();
+	}
+	stopping = false;
+	failed = false;
+	finished.clear();
+	facesUploaded = 0;
+}
+
+// Hands a finished face to the GL thread
+void Skybox::Publish(Face face)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	finished.push_back(std::move(face));
+}
\ No newline at end of file
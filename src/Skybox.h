@@ -0,0 +1,82 @@
+#ifndef SKYBOX_CLASS_H
+#define SKYBOX_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<array>
+#include<atomic>
+#include<deque>
+#include<mutex>
+#include<string>
+#include<thread>
+#include<vector>
+
+#include"VAO.h"
+#include"VBO.h"
+#include"shaderClass.h"
+
+// Background cubemap drawn after the scene at the far plane, so only pixels no body covers are shaded.
+// Faces are decoded or generated on a background thread and uploaded one per frame; the skybox
+// is drawn once all six faces are on the GPU.
+class Skybox
+{
+public:
+	// Creates the cube geometry and an empty cubemap; the GL context must be current
+	Skybox();
+	// Stops the loader and deletes the GL objects
+	~Skybox();
+
+	Skybox(const Skybox&) = delete;
+	Skybox& operator=(const Skybox&) = delete;
+
+	// Decodes six image files in the order +X, -X, +Y, -Y, +Z, -Z in the background
+	void LoadFaces(const std::array<std::string, 6>& paths);
+	// Generates a procedural starfield in the background, or reads it from cachePath if it was baked before
+	void LoadStarfield(const std::string& cachePath, int faceSize, int starCount, unsigned int seed);
+
+	// Uploads at most one finished face; call once per frame on the GL thread
+	void Update();
+	// Draws the skybox with the rotation of view only; call after the opaque passes and before the blended ones
+	void Draw(Shader& shader, const glm::mat4& view, const glm::mat4& projection);
+
+	// Whether all six faces are uploaded
+	bool Ready() const { return facesUploaded == 6; }
+	// Whether faces are still on their way; false once they are all uploaded or the load failed
+	bool Loading() const { return facesUploaded < 6 && !failed; }
+
+	// Stops the loader and deletes the GL objects
+	void Delete();
+
+private:
+	// One face in RGBA8, produced by the loader thread
+	struct Face
+	{
+		int index;
+		int size;
+		std::vector<unsigned char> pixels;
+	};
+
+	// Waits for any previous load and clears the cubemap before a new one starts
+	void Restart();
+	// Hands a finished face to the GL thread
+	void Publish(Face face);
+
+	VAO vao;
+	VBO vbo;
+	GLuint cubemap = 0;
+	int facesUploaded = 0;
+
+	std::thread loader;
+	std::atomic<bool> stopping{ false };
+	// Set by the loader when a face could not be read; the skybox then stays empty
+	std::atomic<bool> failed{ false };
+	std::mutex mutex;
+	std::deque<Face> finished;
+};
+
+// Renders a starfield into six RGBA8 cube faces of faceSize x faceSize in the order +X, -X, +Y, -Y, +Z, -Z.
+// Stars are placed by direction, so they do not bunch up at face edges or leave seams.
+// Returns false if stop became true before it finished.
+bool generateStarfield(int faceSize, int starCount, unsigned int seed, std::vector<unsigned char> faces[6], const std::atomic<bool>& stop);
+
+#endif
\ No newline at end of file
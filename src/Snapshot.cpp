@@ -0,0 +1,288 @@
+#include"Snapshot.h"
+
+#include<algorithm>
+#include<cstring>
+#include<filesystem>
+#include<fstream>
+#include<iostream>
+
+#include"Tracer.h"
+
+namespace
+{
+	const char snapshotMagic[8] = { 'N', 'B', 'O', 'D', 'Y', 'S', 'N', 'P' };
+	const uint32_t snapshotVersion = 1;
+	// Written as is, so a file from a machine with the other byte order reads back swapped and is rejected
+	const uint32_t byteOrderMark = 0x01020304;
+	// Columns start on cache line boundaries so mapped arrays are aligned for any element type
+	const uint64_t columnAlignment = 64;
+
+	struct SnapshotHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byteOrder;
+		uint64_t bodyCount;
+		double simulationTime;
+		SimulationParameters parameters;
+		uint32_t columnCount;
+		uint8_t reserved[8];
+	};
+	static_assert(sizeof(SimulationParameters) == 20, "snapshot parameters changed size");
+	static_assert(sizeof(SnapshotHeader) == 64, "snapshot header must stay 64 bytes");
+
+	struct ColumnEntry
+	{
+		uint32_t id;
+		uint32_t bytesPerBody;
+		uint64_t offset;
+	};
+
+	// Bytes per body of each known column, indexed by column id
+	const uint32_t columnBytesPerBody[SnapshotFile::columnCount + 1] = {
+		0, 3 * sizeof(double), 3 * sizeof(double), sizeof(double), sizeof(double), 3 * sizeof(float), sizeof(int32_t)
+	};
+
+	uint64_t alignUp(uint64_t value)
+	{
+		return (value + columnAlignment - 1) / columnAlignment * columnAlignment;
+	}
+}
+
+// Sizes every column for count bodies
+void SnapshotData::Resize(size_t count)
+{
+	positions.resize(count * 3);
+	velocities.resize(count * 3);
+	masses.resize(count);
+	radii.resize(count);
+	colors.resize(count * 3);
+	meshIds.resize(count);
+}
+
+// Writes a snapshot through a temporary file so a crash never leaves a torn checkpoint behind
+bool writeSnapshot(const std::string& path, const SnapshotData& data)
+{
+	struct Source
+	{
+		uint32_t id;
+		uint32_t bytesPerBody;
+		const void* bytes;
+	};
+	const Source sources[] = {
+		{ SnapshotFile::columnPosition, 3 * sizeof(double), data.positions.data() },
+		{ SnapshotFile::columnVelocity, 3 * sizeof(double), data.velocities.data() },
+		{ SnapshotFile::columnMass, sizeof(double), data.masses.data() },
+		{ SnapshotFile::columnRadius, sizeof(double), data.radii.data() },
+		{ SnapshotFile::columnColor, 3 * sizeof(float), data.colors.data() },
+		{ SnapshotFile::columnMesh, sizeof(int32_t), data.meshIds.data() },
+	};
+	const uint32_t columnCount = sizeof(sources) / sizeof(sources[0]);
+
+	SnapshotHeader header = {};
+	std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+	header.version = snapshotVersion;
+	header.byteOrder = byteOrderMark;
+	header.bodyCount = data.BodyCount();
+	header.simulationTime = data.simulationTime;
+	header.parameters = data.parameters;
+	header.columnCount = columnCount;
+
+	ColumnEntry entries[columnCount];
+	uint64_t offset = alignUp(sizeof(header) + sizeof(entries));
+	for (uint32_t i = 0; i < columnCount; i++)
+	{
+		entries[i] = { sources[i].id, sources[i].bytesPerBody, offset };
+		offset = alignUp(offset + header.bodyCount * sources[i].bytesPerBody);
+	}
+
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			std::cout << "Could not create snapshot: " << temporaryPath << std::endl;
+			return false;
+		}
+		const char padding[columnAlignment] = {};
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(entries), sizeof(entries));
+		uint64_t written = sizeof(header) + sizeof(entries);
+		for (uint32_t i = 0; i < columnCount; i++)
+		{
+			out.write(padding, entries[i].offset - written);
+			uint64_t bytes = header.bodyCount * sources[i].bytesPerBody;
+			out.write(static_cast<const char*>(sources[i].bytes), bytes);
+			written = entries[i].offset + bytes;
+		}
+		if (!out)
+		{
+			std::cout << "Could not write snapshot: " << temporaryPath << std::endl;
+			return false;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+	{
+		std::cout << "Could not replace snapshot " << path << ": " << error.message() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Maps and validates the file at path
+SnapshotFile::SnapshotFile(const char* path)
+	: file(path)
+{
+	if (!file.Valid())
+	{
+		error = "could not open the file";
+		return;
+	}
+
+	SnapshotHeader header;
+	if (file.Size() < sizeof(header))
+	{
+		error = "the file is too small to be a snapshot";
+		return;
+	}
+	std::memcpy(&header, file.Data(), sizeof(header));
+	if (std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0)
+	{
+		error = "the file is not a snapshot";
+		return;
+	}
+	if (header.byteOrder != byteOrderMark)
+	{
+		error = "the snapshot was written on a machine with a different byte order";
+		return;
+	}
+	if (header.version > snapshotVersion)
+	{
+		error = "the snapshot was written by a newer version";
+		return;
+	}
+
+	uint64_t tableEnd = sizeof(header) + static_cast<uint64_t>(header.columnCount) * sizeof(ColumnEntry);
+	if (tableEnd > file.Size())
+	{
+		error = "the column table is truncated";
+		return;
+	}
+	const ColumnEntry* entries = reinterpret_cast<const ColumnEntry*>(file.Data() + sizeof(header));
+	for (uint32_t i = 0; i < header.columnCount; i++)
+	{
+		const ColumnEntry& entry = entries[i];
+		if (entry.offset % columnAlignment != 0 || entry.offset > file.Size()
+			|| header.bodyCount > (file.Size() - entry.offset) / std::max<uint32_t>(entry.bytesPerBody, 1))
+		{
+			error = "a column lies outside the file";
+			return;
+		}
+		// Unknown columns come from newer writers and are skipped
+		if (entry.id >= 1 && entry.id <= columnCount)
+		{
+			// The arrays are read with the element type of the column, so a different width would read past the end
+			if (entry.bytesPerBody != columnBytesPerBody[entry.id])
+			{
+				error = "a column has the wrong size per body";
+				return;
+			}
+			columns[entry.id] = file.Data() + entry.offset;
+		}
+	}
+
+	bodyCount = static_cast<size_t>(header.bodyCount);
+	simulationTime = header.simulationTime;
+	parameters = header.parameters;
+	valid = true;
+}
+
+// Start of a column in the mapping, or nullptr if the file has no such column
+const void* SnapshotFile::Column(uint32_t id) const
+{
+	return valid && id >= 1 && id <= columnCount ? columns[id] : nullptr;
+}
+
+// Starts the writer thread
+SnapshotWriter::SnapshotWriter()
+{
+	worker = std::thread(&SnapshotWriter::WorkerLoop, this);
+}
+
+// Finishes the save in progress and stops the thread
+SnapshotWriter::~SnapshotWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+// Queues data to be written to path
+void SnapshotWriter::Save(const std::string& path, SnapshotData data)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pendingPath = path;
+		pending = std::move(data);
+		hasPending = true;
+	}
+	wake.notify_one();
+}
+
+// Whether a save is queued or being written
+bool SnapshotWriter::Busy() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return hasPending || writing;
+}
+
+// Path of the last finished save
+std::string SnapshotWriter::LastPath() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return lastPath;
+}
+
+// Whether the last finished save succeeded
+bool SnapshotWriter::LastSucceeded() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return lastSucceeded;
+}
+
+// Writes queued snapshots until the writer is destroyed; a queued save is still written when stopping
+void SnapshotWriter::WorkerLoop()
+{
+	Tracer::NameThread("Snapshot writer");
+	std::string path;
+	SnapshotData data;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || hasPending; });
+			if (!hasPending)
+			{
+				return;
+			}
+			path.swap(pendingPath);
+			std::swap(data, pending);
+			hasPending = false;
+			writing = true;
+		}
+
+		TraceZone zone("Write snapshot");
+		bool succeeded = writeSnapshot(path, data);
+		zone.End();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		writing = false;
+		lastPath = path;
+		lastSucceeded = succeeded;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#ifndef SNAPSHOT_CLASS_H
+#define SNAPSHOT_CLASS_H
+
+#include<condition_variable>
+#include<cstdint>
+#include<mutex>
+#include<string>
+#include<thread>
+#include<vector>
+
+#include"MappedFile.h"
+
+// Settings a run needs to continue exactly where it stopped
+struct SimulationParameters
+{
+	float timeStep;
+	float theta;
+	float physicsRate;
+	int32_t stepsPerOctreeRebuild;
+	int32_t stepsPerVisualFrame;
+};
+
+// Simulation state in the column layout of a snapshot: one array per body field
+struct SnapshotData
+{
+	double simulationTime = 0.0;
+	SimulationParameters parameters = {};
+	std::vector<double> positions; // x, y, z per body
+	std::vector<double> velocities; // x, y, z per body
+	std::vector<double> masses;
+	std::vector<double> radii;
+	std::vector<float> colors; // r, g, b per body
+	std::vector<int32_t> meshIds;
+
+	size_t BodyCount() const { return masses.size(); }
+	// Sizes every column for count bodies
+	void Resize(size_t count);
+};
+
+// Writes a snapshot through a temporary file so a crash never leaves a torn checkpoint behind.
+// The file is a fixed header, a column table and one 64-byte aligned array per column, so it
+// can be mapped and used in place. Returns false and prints the reason on failure.
+bool writeSnapshot(const std::string& path, const SnapshotData& data);
+
+// A snapshot file mapped into memory. Opening only validates the header and the column table;
+// the columns are read straight from the mapping without parsing or copying.
+class SnapshotFile
+{
+public:
+	// Maps and validates the file at path; Valid() is false and Error() says why if that fails
+	explicit SnapshotFile(const char* path);
+
+	bool Valid() const { return valid; }
+	const std::string& Error() const { return error; }
+
+	size_t BodyCount() const { return bodyCount; }
+	double SimulationTime() const { return simulationTime; }
+	const SimulationParameters& Parameters() const { return parameters; }
+
+	// Columns in the layout of SnapshotData; a column missing from the file returns nullptr
+	const double* Positions() const { return static_cast<const double*>(Column(columnPosition)); }
+	const double* Velocities() const { return static_cast<const double*>(Column(columnVelocity)); }
+	const double* Masses() const { return static_cast<const double*>(Column(columnMass)); }
+	const double* Radii() const { return static_cast<const double*>(Column(columnRadius)); }
+	const float* Colors() const { return static_cast<const float*>(Column(columnColor)); }
+	const int32_t* MeshIds() const { return static_cast<const int32_t*>(Column(columnMesh)); }
+
+	// Column identifiers as stored in the file; new columns get new ids so old readers skip them
+	enum : uint32_t
+	{
+		columnPosition = 1,
+		columnVelocity,
+		columnMass,
+		columnRadius,
+		columnColor,
+		columnMesh,
+		columnCount = columnMesh
+	};
+
+private:
+	// Start of a column in the mapping, or nullptr if the file has no such column
+	const void* Column(uint32_t id) const;
+
+	MappedFile file;
+	bool valid = false;
+	std::string error;
+	size_t bodyCount = 0;
+	double simulationTime = 0.0;
+	SimulationParameters parameters = {};
+	const void* columns[columnCount + 1] = {};
+};
+
+// Writes snapshots on a background thread so saving a large scene never stalls a frame.
+// The caller hands over a filled SnapshotData; if a save is still running the newest
+// request replaces any one that has not started yet.
+class SnapshotWriter
+{
+public:
+	// Starts the writer thread
+	SnapshotWriter();
+	// Finishes the save in progress and stops the thread
+	~SnapshotWriter();
+
+	SnapshotWriter(const SnapshotWriter&) = delete;
+	SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+	// Queues data to be written to path
+	void Save(const std::string& path, SnapshotData data);
+	// Whether a save is queued or being written
+	bool Busy() const;
+	// Path and result of the last finished save, for the UI
+	std::string LastPath() const;
+	bool LastSucceeded() const;
+
+private:
+	// Writes queued snapshots until the writer is destroyed
+	void WorkerLoop();
+
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::string pendingPath;
+	SnapshotData pending;
+	bool hasPending = false;
+	bool writing = false;
+	std::string lastPath;
+	bool lastSucceeded = false;
+	bool stopping = false;
+	std::thread worker;
+};
+
+#endif
\ No newline at end of file
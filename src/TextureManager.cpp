@@ -0,0 +1,226 @@
+#include"TextureManager.h"
+
+#include<cstring>
+#include<iostream>
+#include<stb/stb_image.h>
+
+#include"Tracer.h"
+
+// Starts the decoding threads; the GL context must be current on the calling thread
+TextureManager::TextureManager(unsigned int workerCount)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		pixelBuffers.emplace_back(nullptr, 0, GL_STREAM_DRAW);
+	}
+	pixelBuffers.back().Unbind();
+
+	if (workerCount == 0)
+	{
+		workerCount = 1;
+	}
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&TextureManager::WorkerLoop, this);
+	}
+}
+
+// Stops the workers and deletes every texture
+TextureManager::~TextureManager()
+{
+	Delete();
+}
+
+// Returns the handle of the texture for path, queuing it for decoding the first time. Never blocks.
+int TextureManager::Request(const std::string& path)
+{
+	auto found = handles.find(path);
+	if (found != handles.end())
+	{
+		return found->second;
+	}
+
+	int handle = static_cast<int>(entries.size());
+	Entry entry;
+	entry.path = path;
+	entries.push_back(entry);
+	handles[path] = handle;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		toDecode.emplace_back(handle, path);
+	}
+	wake.notify_one();
+	return handle;
+}
+
+// Uploads decoded images, at least one and then up to maxBytes per call; call once per frame on the GL thread
+void TextureManager::Update(size_t maxBytes)
+{
+	size_t uploaded = 0;
+	while (true)
+	{
+		Decoded image;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (decoded.empty())
+			{
+				return;
+			}
+			size_t bytes = static_cast<size_t>(decoded.front().width) * decoded.front().height * 4;
+			if (uploaded > 0 && uploaded + bytes > maxBytes)
+			{
+				return;
+			}
+			image = decoded.front();
+			decoded.pop_front();
+			uploaded += bytes;
+		}
+
+		if (image.pixels == nullptr)
+		{
+			entries[image.handle].failed = true;
+			std::cout << "TextureManager could not decode: " << entries[image.handle].path << std::endl;
+			continue;
+		}
+		Upload(image);
+		stbi_image_free(image.pixels);
+	}
+}
+
+// GL texture of a handle, or 0 while it is still loading or if it failed to load
+GLuint TextureManager::GetID(int handle) const
+{
+	if (handle < 0 || handle >= static_cast<int>(entries.size()))
+	{
+		return 0;
+	}
+	return entries[handle].id;
+}
+
+// Whether a handle failed to decode, so callers can stop waiting for it
+bool TextureManager::Failed(int handle) const
+{
+	return handle >= 0 && handle < static_cast<int>(entries.size()) && entries[handle].failed;
+}
+
+// Number of requested textures that are not uploaded or failed yet
+size_t TextureManager::Pending() const
+{
+	size_t pending = 0;
+	for (const Entry& entry : entries)
+	{
+		if (entry.id == 0 && !entry.failed)
+		{
+			pending++;
+		}
+	}
+	return pending;
+}
+
+// Stops the workers and deletes every texture
+void TextureManager::Delete()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		toDecode.clear();
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+
+	for (Decoded& image : decoded)
+	{
+		stbi_image_free(image.pixels);
+	}
+	decoded.clear();
+
+	for (Entry& entry : entries)
+	{
+		if (entry.id != 0)
+		{
+			glDeleteTextures(1, &entry.id);
+			entry.id = 0;
+		}
+	}
+	pixelBuffers.clear();
+}
+
+// Decodes queued paths until the manager is stopped
+void TextureManager::WorkerLoop()
+{
+	Tracer::NameThread("Texture decoder");
+	while (true)
+	{
+		int handle;
+		std::string path;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !toDecode.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+			// entries belongs to the GL thread, so the path travels with the queued handle
+			handle = toDecode.front().first;
+			path = std::move(toDecode.front().second);
+			toDecode.pop_front();
+		}
+
+		TraceZone zone("Decode texture");
+		Decoded image;
+		image.handle = handle;
+		int channels;
+		// Always decode to RGBA so every row is 4-byte aligned for the upload
+		image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &channels, 4);
+		if (image.pixels == nullptr)
+		{
+			image.width = 0;
+			image.height = 0;
+		}
+		zone.End();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(image);
+	}
+}
+
+// Copies one decoded image into a pixel buffer and creates the mipmapped texture from it
+void TextureManager::Upload(const Decoded& image)
+{
+	GLsizeiptr size = static_cast<GLsizeiptr>(image.width) * image.height * 4;
+	VBO& pixelBuffer = pixelBuffers[nextPixelBuffer];
+	nextPixelBuffer = (nextPixelBuffer + 1) % pixelBuffers.size();
+
+	// Orphaning the buffer lets the driver hand out fresh memory instead of waiting for a previous transfer
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.ID);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped == nullptr)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		entries[image.handle].failed = true;
+		return;
+	}
+	std::memcpy(mapped, image.pixels, static_cast<size_t>(size));
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	Entry& entry = entries[image.handle];
+	glGenTextures(1, &entry.id);
+	glBindTexture(GL_TEXTURE_2D, entry.id);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// With a pixel buffer bound the data pointer is an offset into it, and the copy is done by the driver
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width, image.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	entry.width = image.width;
+	entry.height = image.height;
+}
\ No newline at end of file
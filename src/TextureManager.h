@@ -0,0 +1,88 @@
+#ifndef TEXTURE_MANAGER_CLASS_H
+#define TEXTURE_MANAGER_CLASS_H
+
+#include<glad/glad.h>
+#include<condition_variable>
+#include<deque>
+#include<mutex>
+#include<string>
+#include<thread>
+#include<unordered_map>
+#include<utility>
+#include<vector>
+
+#include"VBO.h"
+
+// Loads image files into mipmapped GL textures without blocking the render loop.
+// Images are decoded with stb_image on worker threads, then copied into pixel buffer objects
+// on the GL thread so the texture upload itself runs asynchronously in the driver.
+// Every path is loaded once; later requests return the cached texture.
+class TextureManager
+{
+public:
+	// Starts the decoding threads; the GL context must be current on the calling thread
+	explicit TextureManager(unsigned int workerCount = 2);
+	// Stops the workers and deletes every texture
+	~TextureManager();
+
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	// Returns the handle of the texture for path, queuing it for decoding the first time. Never blocks.
+	int Request(const std::string& path);
+
+	// Uploads decoded images, at least one and then up to maxBytes per call; call once per frame on the GL thread
+	void Update(size_t maxBytes = 16 * 1024 * 1024);
+
+	// GL texture of a handle, or 0 while it is still loading or if it failed to load
+	GLuint GetID(int handle) const;
+	// Whether a handle failed to decode, so callers can stop waiting for it
+	bool Failed(int handle) const;
+	// Number of requested textures that are not uploaded or failed yet
+	size_t Pending() const;
+
+	// Stops the workers and deletes every texture
+	void Delete();
+
+private:
+	struct Entry
+	{
+		std::string path;
+		GLuint id = 0;
+		int width = 0;
+		int height = 0;
+		bool failed = false;
+	};
+
+	// A decoded image waiting for upload; pixels come from stbi_load and are freed after the upload
+	struct Decoded
+	{
+		int handle;
+		int width;
+		int height;
+		unsigned char* pixels;
+	};
+
+	// Decodes queued paths until the manager is stopped
+	void WorkerLoop();
+	// Copies one decoded image into a pixel buffer and creates the mipmapped texture from it
+	void Upload(const Decoded& image);
+
+	std::vector<Entry> entries;
+	std::unordered_map<std::string, int> handles;
+
+	// Shared with the workers
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	// handle and path of every image waiting for a worker
+	std::deque<std::pair<int, std::string>> toDecode;
+	std::deque<Decoded> decoded;
+	bool stopping = false;
+	std::vector<std::thread> workers;
+
+	// Pixel buffers are used round robin so a new upload never waits on the previous one
+	std::vector<VBO> pixelBuffers;
+	size_t nextPixelBuffer = 0;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include"Tracer.h"
+
+#include<algorithm>
+#include<atomic>
+#include<chrono>
+#include<cstdio>
+#include<memory>
+#include<mutex>
+#include<set>
+
+namespace
+{
+	// Events each thread keeps; at a few hundred zones per frame this is several seconds of history
+	const uint64_t ringSize = 1 << 15;
+	const int frameHistory = 64;
+
+	// Written only by its thread; readers check the count around their copy and drop what may have been overwritten
+	struct ThreadBuffer
+	{
+		uint32_t id;
+		std::string name;
+		std::atomic<uint64_t> count{ 0 };
+		TraceEvent events[ringSize];
+	};
+
+	std::atomic<bool> enabled{ true };
+	const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+	std::mutex registryMutex; // guards threads, thread names and interned names
+	std::vector<std::unique_ptr<ThreadBuffer>> threads; // never freed, a thread's history outlives it
+	std::set<std::string> internedNames;
+
+	std::atomic<uint64_t> frameStarts[frameHistory];
+	std::atomic<uint64_t> frameCount{ 0 };
+
+	thread_local ThreadBuffer* currentBuffer = nullptr;
+	thread_local uint32_t currentDepth = 0;
+
+	ThreadBuffer& bufferForThread()
+	{
+		if (currentBuffer == nullptr)
+		{
+			std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+			std::lock_guard<std::mutex> lock(registryMutex);
+			buffer->id = static_cast<uint32_t>(threads.size());
+			buffer->name = buffer->id == 0 ? "Main" : "Thread " + std::to_string(buffer->id);
+			currentBuffer = buffer.get();
+			threads.push_back(std::move(buffer));
+		}
+		return *currentBuffer;
+	}
+
+	// Copies the events of one buffer that overlap [from, to). A thread records a zone when it ends, so the
+	// buffer is in order of end time and the scan can walk back from the newest event and stop early.
+	void copyEvents(const ThreadBuffer& buffer, uint64_t from, uint64_t to, std::vector<TraceEvent>& out)
+	{
+		uint64_t before = buffer.count.load(std::memory_order_acquire);
+		uint64_t first = before > ringSize ? before - ringSize : 0;
+		uint64_t index = before;
+		std::vector<TraceEvent> copied; // newest first, copied[k] is event before - 1 - k
+		while (index > first)
+		{
+			const TraceEvent& event = buffer.events[(index - 1) % ringSize];
+			if (event.end <= from)
+			{
+				break;
+			}
+			copied.push_back(event);
+			index--;
+		}
+		// The thread may have written over the oldest slots while we read them; those copies are dropped.
+		// It fills slot after % ringSize before publishing after + 1, so event after - ringSize may be half written.
+		uint64_t after = buffer.count.load(std::memory_order_acquire);
+		uint64_t valid = after >= ringSize ? after - ringSize + 1 : 0;
+		for (size_t k = copied.size(); k-- > 0;)
+		{
+			if (before - 1 - k >= valid && copied[k].start < to)
+			{
+				out.push_back(copied[k]);
+			}
+		}
+	}
+
+	void writeEscaped(FILE* file, const char* text)
+	{
+		for (const char* c = text; *c != '\0'; c++)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				std::fputc('\\', file);
+			}
+			std::fputc(*c, file);
+		}
+	}
+}
+
+// Turns recording on or off
+void Tracer::SetEnabled(bool on)
+{
+	enabled.store(on, std::memory_order_relaxed);
+}
+
+bool Tracer::Enabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+// Nanoseconds since the tracer started
+uint64_t Tracer::Now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count());
+}
+
+// Names the calling thread in the timeline and the exported trace
+void Tracer::NameThread(const char* name)
+{
+	ThreadBuffer& buffer = bufferForThread();
+	std::lock_guard<std::mutex> lock(registryMutex);
+	buffer.name = name;
+}
+
+// Id of the calling thread as the timeline shows it
+uint32_t Tracer::CurrentThread()
+{
+	return bufferForThread().id;
+}
+
+// Name of a thread by id
+std::string Tracer::ThreadName(uint32_t id)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	return id < threads.size() ? threads[id]->name : std::string();
+}
+
+// Returns a copy of name that lives as long as the program
+const char* Tracer::Intern(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	return internedNames.insert(name).first->c_str();
+}
+
+// Records a finished zone on the calling thread
+void Tracer::Record(const char* name, uint64_t start, uint64_t end, uint32_t depth)
+{
+	ThreadBuffer& buffer = bufferForThread();
+	uint64_t count = buffer.count.load(std::memory_order_relaxed);
+	buffer.events[count % ringSize] = { name, start, end, depth };
+	buffer.count.store(count + 1, std::memory_order_release);
+}
+
+// Marks the start of a frame
+void Tracer::BeginFrame()
+{
+	uint64_t frame = frameCount.load(std::memory_order_relaxed);
+	frameStarts[frame % frameHistory].store(Now(), std::memory_order_relaxed);
+	frameCount.store(frame + 1, std::memory_order_release);
+}
+
+// Start time of the frame ago frames back, 0 being the current one
+uint64_t Tracer::FrameStart(int ago)
+{
+	uint64_t count = frameCount.load(std::memory_order_acquire);
+	if (ago < 0 || ago >= frameHistory || static_cast<uint64_t>(ago) >= count)
+	{
+		return 0;
+	}
+	return frameStarts[(count - 1 - ago) % frameHistory].load(std::memory_order_relaxed);
+}
+
+// Copies the events of every thread that overlap [from, to)
+std::vector<ThreadTrace> Tracer::Collect(uint64_t from, uint64_t to)
+{
+	std::vector<ThreadTrace> result;
+	std::lock_guard<std::mutex> lock(registryMutex);
+	for (const std::unique_ptr<ThreadBuffer>& buffer : threads)
+	{
+		ThreadTrace trace;
+		trace.id = buffer->id;
+		trace.name = buffer->name;
+		copyEvents(*buffer, from, to, trace.events);
+		if (!trace.events.empty())
+		{
+			result.push_back(std::move(trace));
+		}
+	}
+	return result;
+}
+
+// Adds up the zones that ended in [from, to) by name
+std::vector<ZoneTotal> Tracer::Totals(uint64_t from, uint64_t to)
+{
+	std::vector<ZoneTotal> totals;
+	for (const ThreadTrace& thread : Collect(from, to))
+	{
+		for (const TraceEvent& event : thread.events)
+		{
+			if (event.end < from || event.end >= to)
+			{
+				continue;
+			}
+			auto found = std::find_if(totals.begin(), totals.end(), [&event](const ZoneTotal& total) { return total.name == event.name; });
+			if (found == totals.end())
+			{
+				totals.push_back({ event.name, 0, 0.0, 0.0 });
+				found = totals.end() - 1;
+			}
+			double ms = (event.end - event.start) * 1e-6;
+			found->count++;
+			found->totalMs += ms;
+			found->maxMs = std::max(found->maxMs, ms);
+		}
+	}
+	return totals;
+}
+
+// Bytes of the per-thread buffers
+size_t Tracer::MemoryBytes()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	return threads.size() * sizeof(ThreadBuffer);
+}
+
+// Writes traces as complete ("X") events with microsecond times, plus a name for every thread
+bool Tracer::ExportChromeTrace(const std::string& path, const std::vector<ThreadTrace>& traces)
+{
+	FILE* file = std::fopen(path.c_str(), "wb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+	std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+	bool first = true;
+	for (const ThreadTrace& trace : traces)
+	{
+		std::fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", first ? "" : ",\n", trace.id);
+		writeEscaped(file, trace.name.c_str());
+		std::fputs("\"}}", file);
+		first = false;
+		for (const TraceEvent& event : trace.events)
+		{
+			std::fputs(",\n{\"ph\":\"X\",\"name\":\"", file);
+			writeEscaped(file, event.name);
+			std::fprintf(file, "\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", trace.id, event.start * 1e-3, (event.end - event.start) * 1e-3);
+		}
+	}
+	std::fputs("\n]}\n", file);
+	return std::fclose(file) == 0;
+}
+
+// Opens a zone on the current thread
+TraceZone::TraceZone(const char* name)
+	: name(name), start(Tracer::Now())
+{
+	currentDepth++;
+}
+
+// Closes the zone early and returns its length in milliseconds
+double TraceZone::End()
+{
+	if (open)
+	{
+		open = false;
+		currentDepth--;
+		uint64_t end = Tracer::Now();
+		lengthMs = (end - start) * 1e-6;
+		if (Tracer::Enabled())
+		{
+			Tracer::Record(name, start, end, currentDepth);
+		}
+	}
+	return lengthMs;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef TRACER_CLASS_H
+#define TRACER_CLASS_H
+
+#include<cstdint>
+#include<string>
+#include<vector>
+
+// One finished zone: a named span of time on one thread, nested depth levels deep
+struct TraceEvent
+{
+	const char* name;
+	uint64_t start; // nanoseconds since the tracer started, steady clock
+	uint64_t end;
+	uint32_t depth;
+};
+
+// The events one thread recorded, oldest first
+struct ThreadTrace
+{
+	uint32_t id;
+	std::string name;
+	std::vector<TraceEvent> events;
+};
+
+// Time spent in every zone of one name within a window, over all threads
+struct ZoneTotal
+{
+	const char* name;
+	uint64_t count;
+	double totalMs;
+	double maxMs;
+};
+
+// Records scoped zones from any thread into a ring buffer per thread, so recording never takes a lock
+// and old events are overwritten rather than piling up. Zone names must outlive the tracer: use string
+// literals, or Intern for names built at run time. Reading copies the buffers and can happen at any time.
+class Tracer
+{
+public:
+	// Turns recording on or off; zones opened while off are not recorded
+	static void SetEnabled(bool enabled);
+	static bool Enabled();
+
+	// Nanoseconds since the tracer started
+	static uint64_t Now();
+	// Names the calling thread in the timeline and the exported trace
+	static void NameThread(const char* name);
+	// Id of the calling thread as the timeline shows it, and the name of any thread by id
+	static uint32_t CurrentThread();
+	static std::string ThreadName(uint32_t id);
+	// Returns a copy of name that lives as long as the program, the same pointer for equal names
+	static const char* Intern(const std::string& name);
+	// Records a finished zone on the calling thread
+	static void Record(const char* name, uint64_t start, uint64_t end, uint32_t depth);
+
+	// Marks the start of a frame; the start times of the last few frames are kept for the timeline
+	static void BeginFrame();
+	// Start time of the frame ago frames back, 0 being the current one; 0 if it is not known
+	static uint64_t FrameStart(int ago);
+
+	// Copies the events of every thread that overlap [from, to)
+	static std::vector<ThreadTrace> Collect(uint64_t from, uint64_t to);
+	// Adds up the zones that ended in [from, to) by name, in order of first appearance
+	static std::vector<ZoneTotal> Totals(uint64_t from, uint64_t to);
+	// Bytes of the per-thread buffers
+	static size_t MemoryBytes();
+	// Writes traces in the Chrome trace event format, for chrome://tracing or Perfetto
+	static bool ExportChromeTrace(const std::string& path, const std::vector<ThreadTrace>& threads);
+};
+
+// Records the time from its construction to its destruction, or to End, as a zone on the current thread
+class TraceZone
+{
+public:
+	explicit TraceZone(const char* name);
+	~TraceZone() { End(); }
+
+	TraceZone(const TraceZone&) = delete;
+	TraceZone& operator=(const TraceZone&) = delete;
+
+	// Closes the zone early and returns its length in milliseconds; later calls return the same length
+	double End();
+
+private:
+	const char* name;
+	uint64_t start;
+	double lengthMs = 0.0;
+	bool open = true;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include"TrailRenderer.h"
+
+#include<algorithm>
+#include<iostream>
+
+// Creates an empty ring buffer holding up to length samples per body; the GL context must be current
+TrailRenderer::TrailRenderer(int length, size_t byteBudget)
+	: length(length), byteBudget(byteBudget), samples(nullptr, 0, GL_DYNAMIC_DRAW)
+{
+	samples.Unbind();
+	glGenTextures(1, &samplesTexture);
+	// GL 3.3 only guarantees 65536 texels; most drivers allow far more
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+}
+
+TrailRenderer::~TrailRenderer()
+{
+	Delete();
+}
+
+// Records the newest position of every body; a change in the number of bodies starts the history over
+void TrailRenderer::AddSample(const float* positions, int count)
+{
+	if (count != bodyCount)
+	{
+		bodyCount = count;
+		Reset();
+		disabled = bodyCount > 0 && !Allocate(bodyCount);
+	}
+	if (bodyCount == 0 || disabled)
+	{
+		return;
+	}
+
+	staging.resize(trailedBodies);
+	for (int i = 0; i < trailedBodies; i++)
+	{
+		staging[i] = glm::vec4(positions[i * 3 + 0], positions[i * 3 + 1], positions[i * 3 + 2], 1.0f);
+	}
+
+	head = (head + 1) % slots;
+	if (filled < slots)
+	{
+		filled++;
+	}
+	// Slots are capacity apart; only the part of the slot that is in use is written
+	samples.Bind();
+	glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(head) * capacity * sizeof(glm::vec4),
+		static_cast<GLsizeiptr>(trailedBodies) * sizeof(glm::vec4), staging.data());
+	samples.Unbind();
+}
+
+// Fits count bodies into the texture buffer limit and the byte budget and grows the buffer if needed
+bool TrailRenderer::Allocate(int count)
+{
+	std::string previous = status;
+	size_t texels = std::min(static_cast<size_t>(std::max(maxTexels, 0)), byteBudget / sizeof(glm::vec4));
+	// Shorter trails first, then trails on only the first bodies
+	int samplesPerBody = static_cast<int>(std::min<size_t>(length, texels / count));
+	int bodies = count;
+	if (samplesPerBody < std::min(length, minimumSamples))
+	{
+		samplesPerBody = std::min(length, minimumSamples);
+		bodies = static_cast<int>(std::min<size_t>(count, texels / samplesPerBody));
+	}
+
+	bool fits = bodies > 0;
+	if (fits && (bodies > capacity || samplesPerBody != slots))
+	{
+		// Grow with headroom where the limits allow, so bodies added one by one do not reallocate every time
+		int grown = static_cast<int>(std::min<size_t>(bodies + bodies / 2, texels / samplesPerBody));
+		// Clear errors left by earlier calls so the check below only sees this allocation
+		while (glGetError() != GL_NO_ERROR)
+		{
+		}
+		samples.Bind();
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(grown) * samplesPerBody * sizeof(glm::vec4), nullptr, GL_DYNAMIC_DRAW);
+		samples.Unbind();
+		glBindTexture(GL_TEXTURE_BUFFER, samplesTexture);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, samples.ID);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		fits = glGetError() == GL_NO_ERROR;
+		capacity = fits ? grown : 0;
+		slots = fits ? samplesPerBody : 0;
+	}
+
+	if (!fits)
+	{
+		trailedBodies = 0;
+		status = "Trails are off: the trail buffer for " + std::to_string(count) + " bodies could not be allocated";
+	}
+	else
+	{
+		trailedBodies = bodies;
+		if (bodies < count)
+		{
+			status = "Trails on the first " + std::to_string(bodies) + " of " + std::to_string(count) + " bodies, "
+				+ std::to_string(slots) + " samples each, to fit the trail buffer";
+		}
+		else if (slots < length)
+		{
+			status = "Trails shortened to " + std::to_string(slots) + " samples to fit the trail buffer";
+		}
+		else
+		{
+			status.clear();
+		}
+	}
+	if (status != previous && !status.empty())
+	{
+		std::cout << status << std::endl;
+	}
+	return fits;
+}
+
+// Forgets the history, e.g. after bodies were edited or the simulation was reset
+void TrailRenderer::Reset()
+{
+	head = -1;
+	filled = 0;
+}
+
+// Draws one line strip per body, fading from the newest sample to the oldest
+void TrailRenderer::Draw(Shader& shader, const glm::mat4& camMatrix, const glm::vec3& color)
+{
+	if (filled < 2 || trailedBodies == 0 || disabled)
+	{
+		return;
+	}
+	shader.Activate();
+	shader.setMat4("camMatrix", camMatrix);
+	shader.setVec3("trailColor", color);
+	shader.setInt("samples", 0);
+	shader.setInt("head", head);
+	shader.setInt("length", slots);
+	shader.setInt("stride", capacity);
+	shader.setInt("filled", filled);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_BUFFER, samplesTexture);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+
+	emptyVAO.Bind();
+	glDrawArraysInstanced(GL_LINE_STRIP, 0, filled, trailedBodies);
+	emptyVAO.Unbind();
+
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+// Deletes the GL objects
+void TrailRenderer::Delete()
+{
+	if (samplesTexture != 0)
+	{
+		glDeleteTextures(1, &samplesTexture);
+		samplesTexture = 0;
+	}
+	samples.Delete();
+	emptyVAO.Delete();
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#ifndef TRAIL_RENDERER_CLASS_H
+#define TRAIL_RENDERER_CLASS_H
+
+#include<cstddef>
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<string>
+#include<vector>
+
+#include"VAO.h"
+#include"VBO.h"
+#include"shaderClass.h"
+
+// Keeps the last few positions of every body in a GPU ring buffer and draws them as fading line strips.
+// Samples are stored slot-major, so the newest sample of all bodies is one contiguous range and
+// recording a sample is a single small glBufferSubData no matter how long the trails are.
+// The vertex shader reads the history through a texture buffer, so nothing is rebuilt on the CPU.
+// The buffer is held to GL_MAX_TEXTURE_BUFFER_SIZE and a byte budget: large scenes get shorter trails,
+// then trails on only the first bodies, and none if even that does not fit.
+class TrailRenderer
+{
+public:
+	// Creates an empty ring buffer holding up to length samples per body in at most byteBudget bytes;
+	// the GL context must be current
+	explicit TrailRenderer(int length, size_t byteBudget = 256 * 1024 * 1024);
+	~TrailRenderer();
+
+	TrailRenderer(const TrailRenderer&) = delete;
+	TrailRenderer& operator=(const TrailRenderer&) = delete;
+
+	// Records the newest position of every body; positions holds bodyCount xyz triples.
+	// A change in the number of bodies starts the history over.
+	void AddSample(const float* positions, int bodyCount);
+	// Forgets the history, e.g. after bodies were edited or the simulation was reset
+	void Reset();
+	// Draws one line strip per body, fading from the newest sample to the oldest
+	void Draw(Shader& shader, const glm::mat4& camMatrix, const glm::vec3& color);
+
+	// Samples kept per body and bodies that have a trail, after the limits
+	int Length() const { return slots; }
+	int TrailedBodies() const { return trailedBodies; }
+	// Why trails are shortened, limited or off; empty when every body has its full trail
+	const std::string& Status() const { return status; }
+
+	// Deletes the GL objects
+	void Delete();
+
+private:
+	// Fits count bodies into the limits and grows the buffer if needed; false if trails are off
+	bool Allocate(int count);
+
+	// Trails shorter than this are not worth drawing; bodies are dropped instead
+	static const int minimumSamples = 16;
+
+	int length;
+	size_t byteBudget;
+	GLint maxTexels = 0;
+	int slots = 0;
+	int capacity = 0;
+	int bodyCount = 0;
+	int trailedBodies = 0;
+	bool disabled = false;
+	std::string status;
+	// slot of the newest sample and number of valid samples
+	int head = -1;
+	int filled = 0;
+
+	VBO samples;
+	GLuint samplesTexture = 0;
+	// Core profile draws need a VAO bound even though the trail shader has no vertex attributes
+	VAO emptyVAO;
+	std::vector<glm::vec4> staging;
+};
+
+#endif
\ No newline at end of file
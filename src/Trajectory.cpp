@@ -0,0 +1,488 @@
+#include"Trajectory.h"
+
+#include<algorithm>
+#include<cmath>
+#include<cstring>
+#include<iostream>
+
+#include"Compression.h"
+#include"Tracer.h"
+
+const char trajectoryFileMagic[8] = { 'N', 'B', 'O', 'D', 'Y', 'T', 'R', 'J' };
+const char trajectoryIndexMagic[8] = { 'N', 'B', 'T', 'R', 'J', 'I', 'D', 'X' };
+
+namespace
+{
+	const uint32_t byteOrderMark = 0x01020304;
+	static_assert(sizeof(TrajectoryFileHeader) == 64, "trajectory header must stay 64 bytes");
+	static_assert(sizeof(TrajectoryFrameHeader) == 32, "trajectory frame header must stay 32 bytes");
+	static_assert(sizeof(TrajectoryIndexEntry) == 24, "trajectory index entries must stay 24 bytes");
+}
+
+// Starts the writer thread
+TrajectoryWriter::TrajectoryWriter()
+{
+	worker = std::thread(&TrajectoryWriter::WorkerLoop, this);
+}
+
+// Closes the recording and stops the thread
+TrajectoryWriter::~TrajectoryWriter()
+{
+	Close();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+}
+
+// Starts a new recording at path, closing any previous one
+bool TrajectoryWriter::Open(const std::string& path, const TrajectoryOptions& options)
+{
+	Close();
+
+	out.open(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		std::cout << "Could not create trajectory file: " << path << std::endl;
+		return false;
+	}
+
+	this->options = options;
+	if (this->options.keyframeInterval == 0)
+	{
+		this->options.keyframeInterval = 1;
+	}
+	if (this->options.chunkBodies == 0)
+	{
+		this->options.chunkBodies = 65536;
+	}
+
+	TrajectoryFileHeader header = {};
+	std::memcpy(header.magic, trajectoryFileMagic, sizeof(header.magic));
+	header.version = trajectoryVersion;
+	header.byteOrder = byteOrderMark;
+	header.fields = trajectoryPositions | (this->options.velocities ? static_cast<uint32_t>(trajectoryVelocities) : 0u);
+	header.keyframeInterval = this->options.keyframeInterval;
+	header.positionStep = this->options.positionStep;
+	header.velocityStep = this->options.velocityStep;
+	header.chunkBodies = this->options.chunkBodies;
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	this->path = path;
+	written = sizeof(header);
+	index.clear();
+	lastBodyCount = 0;
+	failed = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		framesWritten = 0;
+		framesDropped = 0;
+		bytesWritten = written;
+		rawBytes = 0;
+	}
+	open = true;
+	return true;
+}
+
+// Writes the last frame, the index and the footer
+void TrajectoryWriter::Close()
+{
+	if (!open)
+	{
+		return;
+	}
+	open = false;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		idle.wait(lock, [this] { return !queued; });
+	}
+
+	TrajectoryFooter footer = {};
+	footer.indexOffset = written;
+	footer.frameCount = index.size();
+	std::memcpy(footer.magic, trajectoryIndexMagic, sizeof(footer.magic));
+	out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(TrajectoryIndexEntry));
+	out.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+	out.close();
+	if (!out)
+	{
+		std::cout << "Could not finish trajectory file: " << path << std::endl;
+	}
+}
+
+// Frame to fill for the next write, or nullptr if the writer is busy
+TrajectoryFrame* TrajectoryWriter::BeginFrame()
+{
+	if (!open)
+	{
+		return nullptr;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	if (queued)
+	{
+		framesDropped++;
+		return nullptr;
+	}
+	return &front;
+}
+
+// Hands the frame from BeginFrame to the writer thread
+void TrajectoryWriter::Submit()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::swap(front, back);
+		queued = true;
+	}
+	wake.notify_one();
+}
+
+uint64_t TrajectoryWriter::FramesWritten() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return framesWritten;
+}
+
+uint64_t TrajectoryWriter::FramesDropped() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return framesDropped;
+}
+
+uint64_t TrajectoryWriter::BytesWritten() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return bytesWritten;
+}
+
+// Size the written frames would have had as plain doubles
+uint64_t TrajectoryWriter::RawBytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return rawBytes;
+}
+
+// Compresses and writes submitted frames until the writer is destroyed
+void TrajectoryWriter::WorkerLoop()
+{
+	Tracer::NameThread("Trajectory writer");
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || queued; });
+			if (!queued)
+			{
+				return;
+			}
+		}
+
+		// back is not touched by anyone else until queued is cleared
+		{
+			TraceZone zone("Write trajectory frame");
+			WriteFrame(back);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queued = false;
+		}
+		idle.notify_all();
+	}
+}
+
+// Quantizes, compresses and appends one frame to the file
+void TrajectoryWriter::WriteFrame(const TrajectoryFrame& frame)
+{
+	if (failed)
+	{
+		return;
+	}
+	uint64_t bodyCount = frame.positions.size() / 3;
+	bool keyframe = index.size() % options.keyframeInterval == 0 || bodyCount != lastBodyCount;
+	lastBodyCount = bodyCount;
+
+	// Field payloads are collected in chunks and chunkSizes, field after field
+	chunkSizes.clear();
+	size_t chunkCount = (bodyCount + options.chunkBodies - 1) / options.chunkBodies;
+	chunks.resize(chunkCount * 2);
+	bool inRange = CompressField(frame.positions, options.positionStep, positionReference, keyframe);
+	size_t fieldCount = 1;
+	if (options.velocities)
+	{
+		inRange = CompressField(frame.velocities, options.velocityStep, velocityReference, keyframe) && inRange;
+		fieldCount = 2;
+	}
+	if (!inRange)
+	{
+		std::cout << "A value at time " << frame.simulationTime << " is too large for the quantization step of " << path
+				  << ", recording stopped" << std::endl;
+		failed = true;
+		return;
+	}
+
+	TrajectoryFrameHeader header = {};
+	header.magic = trajectoryFrameMagic;
+	header.flags = keyframe ? trajectoryKeyframe : 0;
+	header.bodyCount = bodyCount;
+	header.simulationTime = frame.simulationTime;
+	header.payloadBytes = chunkSizes.size() * sizeof(uint32_t);
+	for (uint32_t size : chunkSizes)
+	{
+		header.payloadBytes += size;
+	}
+
+	index.push_back({ written, frame.simulationTime, header.flags, 0 });
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (size_t field = 0; field < fieldCount; field++)
+	{
+		out.write(reinterpret_cast<const char*>(chunkSizes.data() + field * chunkCount), chunkCount * sizeof(uint32_t));
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			const std::vector<uint8_t>& data = chunks[field * chunkCount + chunk];
+			out.write(reinterpret_cast<const char*>(data.data()), data.size());
+		}
+	}
+	if (!out)
+	{
+		std::cout << "Could not write trajectory frame to " << path << ", recording stopped" << std::endl;
+		failed = true;
+		return;
+	}
+	written += sizeof(header) + header.payloadBytes;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	framesWritten++;
+	bytesWritten = written;
+	rawBytes += bodyCount * 3 * sizeof(double) * fieldCount;
+}
+
+// Compresses one field of a frame into chunks against reference, which is updated to the new values.
+// Returns false if a value does not fit a 64-bit integer in units of step.
+bool TrajectoryWriter::CompressField(const std::vector<double>& values, double step, std::vector<int64_t>& reference, bool keyframe)
+{
+	if (keyframe || reference.size() != values.size())
+	{
+		reference.assign(values.size(), 0);
+	}
+
+	size_t chunkCount = (values.size() / 3 + options.chunkBodies - 1) / options.chunkBodies;
+	size_t firstChunk = chunkSizes.size();
+	chunkSizes.resize(firstChunk + chunkCount);
+	double scale = 1.0 / step;
+	// Quantized values and their differences must stay clear of the int64 limits; NaN fails the test as well
+	const double limit = 4611686018427387904.0; // 2^62
+	bool outOfRange = false;
+
+	// Chunks are independent, so a large frame is compressed by every core
+	#pragma omp parallel for schedule(dynamic) reduction(||:outOfRange)
+	for (long long chunk = 0; chunk < static_cast<long long>(chunkCount); chunk++)
+	{
+		TraceZone zone("Compress chunk");
+		size_t begin = static_cast<size_t>(chunk) * options.chunkBodies * 3;
+		size_t end = std::min(begin + static_cast<size_t>(options.chunkBodies) * 3, values.size());
+		bool chunkInRange = true;
+		for (size_t i = begin; i < end; i++)
+		{
+			chunkInRange &= std::abs(values[i] * scale) < limit;
+		}
+		if (!chunkInRange)
+		{
+			outOfRange = true;
+			continue;
+		}
+		// one scratch buffer per thread, kept across frames
+		thread_local std::vector<uint64_t> words;
+		words.resize(end - begin);
+		for (size_t i = begin; i < end; i++)
+		{
+			int64_t quantized = std::llround(values[i] * scale);
+			words[i - begin] = zigzagEncode(quantized - reference[i]);
+			reference[i] = quantized;
+		}
+		std::vector<uint8_t>& data = chunks[firstChunk + chunk];
+		data.clear();
+		compressWords(words.data(), words.size(), data);
+		chunkSizes[firstChunk + chunk] = static_cast<uint32_t>(data.size());
+	}
+	return !outOfRange;
+}
+
+// Maps the file and loads its index
+TrajectoryReader::TrajectoryReader(const char* path)
+	: file(path)
+{
+	if (!file.Valid())
+	{
+		error = "could not open the file";
+		return;
+	}
+	if (file.Size() < sizeof(header))
+	{
+		error = "the file is too small to be a trajectory";
+		return;
+	}
+	std::memcpy(&header, file.Data(), sizeof(header));
+	if (std::memcmp(header.magic, trajectoryFileMagic, sizeof(header.magic)) != 0)
+	{
+		error = "the file is not a trajectory";
+		return;
+	}
+	if (header.byteOrder != byteOrderMark)
+	{
+		error = "the trajectory was written on a machine with a different byte order";
+		return;
+	}
+	if (header.version > trajectoryVersion || header.chunkBodies == 0 || header.positionStep <= 0.0)
+	{
+		error = "the trajectory was written by a newer version";
+		return;
+	}
+
+	// A closed recording ends with its index; the mapping may not be aligned for it, so it is copied out
+	TrajectoryFooter footer;
+	bool indexed = false;
+	if (file.Size() >= sizeof(header) + sizeof(footer))
+	{
+		std::memcpy(&footer, file.Data() + file.Size() - sizeof(footer), sizeof(footer));
+		uint64_t indexBytes = footer.frameCount * sizeof(TrajectoryIndexEntry);
+		indexed = std::memcmp(footer.magic, trajectoryIndexMagic, sizeof(footer.magic)) == 0
+			&& footer.indexOffset <= file.Size() - sizeof(footer)
+			&& indexBytes == file.Size() - sizeof(footer) - footer.indexOffset;
+		if (indexed)
+		{
+			index.resize(static_cast<size_t>(footer.frameCount));
+			std::memcpy(index.data(), file.Data() + footer.indexOffset, indexBytes);
+		}
+	}
+
+	// Otherwise the recording was interrupted; every complete frame is still usable
+	if (!indexed)
+	{
+		uint64_t offset = sizeof(header);
+		TrajectoryFrameHeader frame;
+		while (offset + sizeof(frame) <= file.Size())
+		{
+			std::memcpy(&frame, file.Data() + offset, sizeof(frame));
+			if (frame.magic != trajectoryFrameMagic || frame.payloadBytes > file.Size() - offset - sizeof(frame))
+			{
+				break;
+			}
+			index.push_back({ offset, frame.simulationTime, frame.flags, 0 });
+			offset += sizeof(frame) + frame.payloadBytes;
+		}
+	}
+
+	if (index.empty() || (index.front().flags & trajectoryKeyframe) == 0)
+	{
+		error = "the trajectory has no frames";
+		return;
+	}
+	valid = true;
+}
+
+// Decodes the positions of a frame, x, y, z per body
+bool TrajectoryReader::ReadPositions(size_t frame, std::vector<double>& positions)
+{
+	if (!valid || frame >= index.size())
+	{
+		return false;
+	}
+
+	size_t keyframe = frame;
+	while ((index[keyframe].flags & trajectoryKeyframe) == 0)
+	{
+		keyframe--;
+	}
+	// Playing forward continues from the frame decoded last instead of going back to the keyframe
+	size_t first = decodedFrame != SIZE_MAX && decodedFrame >= keyframe && decodedFrame <= frame ? decodedFrame + 1 : keyframe;
+	for (size_t i = first; i <= frame; i++)
+	{
+		if (!DecodeFrame(i))
+		{
+			decodedFrame = SIZE_MAX;
+			return false;
+		}
+		decodedFrame = i;
+	}
+
+	positions.resize(reference.size());
+	double step = header.positionStep;
+	#pragma omp parallel for
+	for (long long i = 0; i < static_cast<long long>(reference.size()); i++)
+	{
+		positions[i] = reference[i] * step;
+	}
+	return true;
+}
+
+// Applies one frame to the decoded positions, starting from zero for a keyframe
+bool TrajectoryReader::DecodeFrame(size_t frame)
+{
+	const TrajectoryIndexEntry& entry = index[frame];
+	TrajectoryFrameHeader frameHeader;
+	if (entry.offset > file.Size() || file.Size() - entry.offset < sizeof(frameHeader))
+	{
+		return false;
+	}
+	std::memcpy(&frameHeader, file.Data() + entry.offset, sizeof(frameHeader));
+	if (frameHeader.magic != trajectoryFrameMagic || frameHeader.payloadBytes > file.Size() - entry.offset - sizeof(frameHeader))
+	{
+		return false;
+	}
+
+	size_t values = static_cast<size_t>(frameHeader.bodyCount) * 3;
+	if (frameHeader.flags & trajectoryKeyframe)
+	{
+		reference.assign(values, 0);
+	}
+	else if (reference.size() != values)
+	{
+		return false;
+	}
+
+	// Positions are the first field: a table of chunk sizes, then the chunks
+	size_t chunkCount = static_cast<size_t>((frameHeader.bodyCount + header.chunkBodies - 1) / header.chunkBodies);
+	const char* payload = file.Data() + entry.offset + sizeof(frameHeader);
+	if (chunkCount * sizeof(uint32_t) > frameHeader.payloadBytes)
+	{
+		return false;
+	}
+	chunkSizes.resize(chunkCount);
+	std::memcpy(chunkSizes.data(), payload, chunkCount * sizeof(uint32_t));
+	chunkOffsets.resize(chunkCount);
+	size_t offset = chunkCount * sizeof(uint32_t);
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		chunkOffsets[chunk] = offset;
+		offset += chunkSizes[chunk];
+	}
+	if (offset > frameHeader.payloadBytes)
+	{
+		return false;
+	}
+
+	bool intact = true;
+	#pragma omp parallel for schedule(dynamic) reduction(&&:intact)
+	for (long long chunk = 0; chunk < static_cast<long long>(chunkCount); chunk++)
+	{
+		TraceZone zone("Decompress chunk");
+		size_t begin = static_cast<size_t>(chunk) * header.chunkBodies * 3;
+		size_t end = std::min(begin + static_cast<size_t>(header.chunkBodies) * 3, values);
+		thread_local std::vector<uint64_t> words;
+		words.resize(end - begin);
+		const uint8_t* data = reinterpret_cast<const uint8_t*>(payload + chunkOffsets[chunk]);
+		if (!decompressWords(data, chunkSizes[chunk], words.data(), words.size()))
+		{
+			intact = false;
+			continue;
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			reference[i] += zigzagDecode(words[i - begin]);
+		}
+	}
+	return intact;
+}
\ No newline at end of file
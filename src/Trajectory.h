@@ -0,0 +1,196 @@
+#ifndef TRAJECTORY_CLASS_H
+#define TRAJECTORY_CLASS_H
+
+#include<condition_variable>
+#include<cstdint>
+#include<cstddef>
+#include<fstream>
+#include<mutex>
+#include<string>
+#include<thread>
+#include<vector>
+
+#include"MappedFile.h"
+
+// A trajectory file is a header, a stream of frames and, once the recording is closed, an index of
+// every frame followed by a footer pointing at it. Values are quantized to a fixed step and stored
+// as differences to the previous frame, compressed with compressWords in independent chunks of
+// bodies; every keyframeInterval frames (and whenever the body count changes) a keyframe stores
+// differences to zero instead so readers can start decoding there.
+struct TrajectoryFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrder;
+	uint32_t fields; // TrajectoryFields bits
+	uint32_t keyframeInterval;
+	double positionStep; // Mm
+	double velocityStep; // Mm/s
+	uint32_t chunkBodies;
+	uint8_t reserved[20];
+};
+
+// Precedes every frame. The payload holds, for each recorded field, the compressed size of every
+// chunk followed by the chunks themselves.
+struct TrajectoryFrameHeader
+{
+	uint32_t magic;
+	uint32_t flags; // trajectoryKeyframe
+	uint64_t bodyCount;
+	double simulationTime;
+	uint64_t payloadBytes;
+};
+
+struct TrajectoryIndexEntry
+{
+	uint64_t offset;
+	double simulationTime;
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+struct TrajectoryFooter
+{
+	uint64_t indexOffset;
+	uint64_t frameCount;
+	char magic[8];
+};
+
+enum TrajectoryFields : uint32_t
+{
+	trajectoryPositions = 1,
+	trajectoryVelocities = 2
+};
+
+const uint32_t trajectoryKeyframe = 1;
+const uint32_t trajectoryVersion = 1;
+const uint32_t trajectoryFrameMagic = 0x454d5246; // "FRME"
+extern const char trajectoryFileMagic[8];
+extern const char trajectoryIndexMagic[8];
+
+// What to record and how precisely
+struct TrajectoryOptions
+{
+	bool velocities = false;
+	double positionStep = 1e-3; // 1 km
+	double velocityStep = 1e-9; // 1 mm/s
+	uint32_t keyframeInterval = 64;
+	uint32_t chunkBodies = 65536;
+};
+
+// One recorded frame as the simulation fills it: x, y, z per body
+struct TrajectoryFrame
+{
+	double simulationTime = 0.0;
+	std::vector<double> positions;
+	std::vector<double> velocities;
+};
+
+// Records frames to a trajectory file without ever making the simulation wait. There are two frame
+// buffers: the simulation fills one while a background thread quantizes, compresses (chunks in
+// parallel) and writes the other. A frame offered while the writer is still busy is dropped and counted.
+class TrajectoryWriter
+{
+public:
+	// Starts the writer thread
+	TrajectoryWriter();
+	// Closes the recording and stops the thread
+	~TrajectoryWriter();
+
+	TrajectoryWriter(const TrajectoryWriter&) = delete;
+	TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+	// Starts a new recording at path, closing any previous one; returns false and prints the reason on failure
+	bool Open(const std::string& path, const TrajectoryOptions& options);
+	// Writes the last frame, the index and the footer
+	void Close();
+	bool IsOpen() const { return open; }
+	bool RecordsVelocities() const { return options.velocities; }
+
+	// Frame to fill for the next write, or nullptr (and the frame counts as dropped) if the writer is busy
+	TrajectoryFrame* BeginFrame();
+	// Hands the frame from BeginFrame to the writer thread
+	void Submit();
+
+	// Statistics for the UI
+	uint64_t FramesWritten() const;
+	uint64_t FramesDropped() const;
+	uint64_t BytesWritten() const;
+	uint64_t RawBytes() const;
+
+private:
+	// Compresses and writes submitted frames until the writer is destroyed
+	void WorkerLoop();
+	// Quantizes, compresses and appends one frame to the file
+	void WriteFrame(const TrajectoryFrame& frame);
+	// Compresses one field of a frame into chunks against reference, which is updated to the new values;
+	// false if a value is too large for the step
+	bool CompressField(const std::vector<double>& values, double step, std::vector<int64_t>& reference, bool keyframe);
+
+	TrajectoryOptions options;
+	bool open = false;
+	TrajectoryFrame front;
+
+	// Only touched by the writer thread while a frame is queued, and by Open and Close once it is idle
+	std::ofstream out;
+	std::string path;
+	uint64_t written = 0;
+	std::vector<TrajectoryIndexEntry> index;
+	std::vector<int64_t> positionReference;
+	std::vector<int64_t> velocityReference;
+	uint64_t lastBodyCount = 0;
+	std::vector<std::vector<uint8_t>> chunks;
+	std::vector<uint32_t> chunkSizes;
+	bool failed = false;
+
+	// Shared with the writer thread
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	TrajectoryFrame back;
+	bool queued = false;
+	bool stopping = false;
+	uint64_t framesWritten = 0;
+	uint64_t framesDropped = 0;
+	uint64_t bytesWritten = 0;
+	uint64_t rawBytes = 0;
+	std::thread worker;
+};
+
+// Reads a trajectory file in place through a memory mapping. The frame index from the footer gives
+// O(1) access to any frame; files whose recording never closed are indexed by walking the frame
+// headers once. Stepping forward decodes a single frame, a seek decodes from the nearest keyframe.
+class TrajectoryReader
+{
+public:
+	// Maps the file and loads its index; Valid() is false and Error() says why if that fails
+	explicit TrajectoryReader(const char* path);
+
+	bool Valid() const { return valid; }
+	const std::string& Error() const { return error; }
+
+	size_t FrameCount() const { return index.size(); }
+	double FrameTime(size_t frame) const { return index[frame].simulationTime; }
+	bool HasVelocities() const { return (header.fields & trajectoryVelocities) != 0; }
+
+	// Decodes the positions of a frame, x, y, z per body; returns false if the frame is damaged
+	bool ReadPositions(size_t frame, std::vector<double>& positions);
+
+private:
+	// Applies one frame to the decoded positions, starting from zero for a keyframe
+	bool DecodeFrame(size_t frame);
+
+	MappedFile file;
+	bool valid = false;
+	std::string error;
+	TrajectoryFileHeader header = {};
+	std::vector<TrajectoryIndexEntry> index;
+
+	// Quantized positions of decodedFrame
+	std::vector<int64_t> reference;
+	size_t decodedFrame = SIZE_MAX;
+	std::vector<uint32_t> chunkSizes;
+	std::vector<size_t> chunkOffsets;
+};
+
+#endif
\ No newline at end of file
@@ -6,6 +6,31 @@ VAO::VAO()
 	glGenVertexArrays(1, &ID);
 }
 
+// Deletes the VAO when the wrapper goes out of scope
+VAO::~VAO()
+{
+	Delete();
+}
+
+// Takes over the vertex array of another VAO, leaving it empty
+VAO::VAO(VAO&& other) noexcept
+	: ID(other.ID)
+{
+	other.ID = 0;
+}
+
+// Releases the current vertex array and takes over the one of another VAO
+VAO& VAO::operator=(VAO&& other) noexcept
+{
+	if (this != &other)
+	{
+		Delete();
+		ID = other.ID;
+		other.ID = 0;
+	}
+	return *this;
+}
+
 // Links a VBO Attribute such as a position or color to the VAO
 void VAO::LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset)
 {
@@ -30,5 +55,9 @@ void VAO::Unbind()
 // Deletes the VAO
 void VAO::Delete()
 {
-	glDeleteVertexArrays(1, &ID);
+	if (ID != 0)
+	{
+		glDeleteVertexArrays(1, &ID);
+		ID = 0;
+	}
 }
\ No newline at end of file
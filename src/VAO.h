@@ -8,9 +8,17 @@ class VAO
 {
 public:
 	// ID reference for the Vertex Array Object
-	GLuint ID;
+	GLuint ID = 0;
 	// Constructor that generates a VAO ID
 	VAO();
+	// Deletes the VAO when the wrapper goes out of scope
+	~VAO();
+
+	// A VAO owns its GL vertex array, so it can be moved but never copied
+	VAO(const VAO&) = delete;
+	VAO& operator=(const VAO&) = delete;
+	VAO(VAO&& other) noexcept;
+	VAO& operator=(VAO&& other) noexcept;
 
 	// Links a VBO Attribute such as a position or color to the VAO
 	void LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset);
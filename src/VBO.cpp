@@ -1,11 +1,36 @@
 #include"VBO.h"
 
 // Constructor that generates a Vertex Buffer Object and links it to vertices
-VBO::VBO(GLfloat* vertices, GLsizeiptr size)
+VBO::VBO(GLfloat* vertices, GLsizeiptr size, GLenum usage)
 {
 	glGenBuffers(1, &ID);
 	glBindBuffer(GL_ARRAY_BUFFER, ID);
-	glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
+	glBufferData(GL_ARRAY_BUFFER, size, vertices, usage);
+}
+
+// Deletes the VBO when the wrapper goes out of scope
+VBO::~VBO()
+{
+	Delete();
+}
+
+// Takes over the buffer of another VBO, leaving it empty
+VBO::VBO(VBO&& other) noexcept
+	: ID(other.ID)
+{
+	other.ID = 0;
+}
+
+// Releases the current buffer and takes over the buffer of another VBO
+VBO& VBO::operator=(VBO&& other) noexcept
+{
+	if (this != &other)
+	{
+		Delete();
+		ID = other.ID;
+		other.ID = 0;
+	}
+	return *this;
 }
 
 // Binds the VBO
@@ -23,5 +48,9 @@ void VBO::Unbind()
 // Deletes the VBO
 void VBO::Delete()
 {
-	glDeleteBuffers(1, &ID);
+	if (ID != 0)
+	{
+		glDeleteBuffers(1, &ID);
+		ID = 0;
+	}
 }
\ No newline at end of file
@@ -7,9 +7,17 @@ class VBO
 {
 public:
 	// Reference ID of the Vertex Buffer Object
-	GLuint ID;
+	GLuint ID = 0;
 	// Constructor that generates a Vertex Buffer Object and links it to vertices
-	VBO(GLfloat* vertices, GLsizeiptr size);
+	VBO(GLfloat* vertices, GLsizeiptr size, GLenum usage = GL_STATIC_DRAW);
+	// Deletes the VBO when the wrapper goes out of scope
+	~VBO();
+
+	// A VBO owns its GL buffer, so it can be moved but never copied
+	VBO(const VBO&) = delete;
+	VBO& operator=(const VBO&) = delete;
+	VBO(VBO&& other) noexcept;
+	VBO& operator=(VBO&& other) noexcept;
 
 	// Binds the VBO
 	void Bind();
@@ -4,13 +4,22 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <cmath>
 #include <random>
 #include <memory>
+#include <string>
 #include <chrono>
 #include <thread>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <cctype>
 #include <omp.h>
+#include <atomic>
+#include <functional>
+#include <numeric>
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -28,6 +37,29 @@
 #include "VAO.h"
 #include "VBO.h"
 #include "EBO.h"
+#include "BufferManager.h"
+#include "MeshRenderer.h"
+#include "ObjLoader.h"
+#include "TextureManager.h"
+#include "Skybox.h"
+#include "TrailRenderer.h"
+#include "RenderTarget.h"
+#include "DynamicResolution.h"
+#include "FrameGovernor.h"
+#include "FrameStats.h"
+#include "GpuTimer.h"
+#include "MemoryStats.h"
+#include "PerfCounters.h"
+#include "BodyQuery.h"
+#include "BodyStore.h"
+#include "InitialConditions.h"
+#include "JobSystem.h"
+#include "OrbitPredictor.h"
+#include "ParticleImport.h"
+#include "Snapshot.h"
+#include "Trajectory.h"
+#include "RewindBuffer.h"
+#include "Tracer.h"
 #include "Camera.h"
 
 class CelestialBody;
@@ -45,6 +77,7 @@ float time_step = 60.0f; // Initial time step (in seconds)
 bool isPaused = true;
 
 const double objectSize = 1e12f; // determines visible size for bodies in simulation, arbitrary value
+const double renderScale = 1e-3; // Adjust this factor to make bodies visible
 
 float theta = 1.0f; // Barnes-Hut opening angle, controls performance vs accuracy tradeoff
 
@@ -55,16 +88,27 @@ constexpr float initialFar = 1000000.0f;   float far = initialFar;
 constexpr float initialNear = 1.0f;     float near = initialNear;
 
 // for benchmarking
-long int octree_build_time = 0;
-long int force_calculation_time = 0;
-long int vel_pos_update_time = 0;
-long int imgui_render_time = 0;
-long int opengl_render_time = 0;
+// Latest phase lengths in milliseconds, for the frame governor
+float octree_build_ms = 0.0f;
+float force_calculation_ms = 0.0f;
+float vel_pos_update_ms = 0.0f;
 
-int stepsPerOctreeRebuild = 10;
-int stepsPerVisualFrame = 5;
+int stepsPerOctreeRebuild = 10; // counted in physics ticks
+int stepsPerVisualFrame = 5; // substeps per physics tick
 
-std::vector<CelestialBody> celestialBodies;
+// Physics runs in fixed ticks of time_step / physicsRate simulated seconds, independent of the frame rate
+float physicsRate = 60.0f; // ticks per real second
+const int maxTicksPerFrame = 8; // beyond this the simulation slows down instead of stalling the renderer
+
+BodyStore<CelestialBody> celestialBodies;
+std::vector<glm::dvec3> previousPositions; // positions before the last physics tick, rendering interpolates from these
+bool bodiesChanged = true; // set whenever bodies are added or edited outside of physics, cleared once per frame
+
+// bodies are drawn as instances of shared unit meshes; a negative meshId picks a sphere level of detail
+constexpr int SPHERE_MESH = -1;
+constexpr int sphereLodSegments[] = {24, 12, 6};
+constexpr float sphereLodThresholds[] = {0.02f, 0.004f}; // apparent size (scale / distance) needed for each finer level
+int shipMeshId = SPHERE_MESH; // set once assets/spaceship.obj is loaded
 
 // default values for creating new objects in the scene
 bool show_create_body_menu = false;
@@ -72,11 +116,67 @@ bool show_table = false;
 bool show_performance = false;
 bool show_help = false;
 bool show_data = false;
+bool show_skybox = true;
+bool show_trails = false;
 glm::dvec3 new_body_position(0.0, 0.0, 0.0);
 glm::dvec3 new_body_velocity(0.0, 0.0, 0.0);
 double new_body_radius = 1.0;
 double new_body_mass = 1e7;
 glm::vec3 new_body_color(1.0f, 1.0f, 1.0f);
+char new_body_texture[256] = ""; // optional image path, e.g. assets/bricks.jpg
+
+// body editor view, filtered and sorted in the background by BodyQuery
+char body_search[64] = "";
+double body_min_mass = 0.0; // 0 means no bound
+double body_max_mass = 0.0;
+int body_sort_column = 0;
+bool body_sort_descending = false;
+
+// snapshots and periodic checkpoints, written in the background by SnapshotWriter
+char snapshot_path[256] = "simulation.snap";
+float checkpoint_minutes = 0.0f; // real minutes between checkpoints while running, 0 turns them off
+
+// initial conditions generated by InitialConditions, reproducible for a given seed
+int generator_model = generatorPlummer;
+int generator_count = 10000;
+int generator_seed = 1;
+double generator_radius = 150.0; // Mm
+double generator_mass = 1e3; // Rg, the whole model
+
+// initial conditions read from other codes' files by ParticleImport
+char import_path[256] = "ics.csv";
+int import_units = 0; // 0: by format, 1: Mm, Mm/s and Rg, 2: Gadget's kpc, km/s and 1e10 solar masses
+bool import_replace = true;
+
+// trajectory recording, compressed and written in the background by TrajectoryWriter
+char trajectory_path[256] = "simulation.traj";
+int trajectory_cadence = 10; // physics ticks between recorded frames
+float trajectory_precision = 1e-3f; // Mm, positions are rounded to multiples of this
+bool trajectory_velocities = false;
+
+// playback of a recorded trajectory, shown instead of the live simulation while a file is open
+bool show_playback = false;
+char playback_path[256] = "simulation.traj";
+float playback_speed = 30.0f; // recorded frames per real second, negative plays backwards
+
+// rewind history, captured while running and compressed in the background by RewindBuffer
+bool show_rewind = false;
+bool rewind_enabled = true;
+float rewind_interval = 0.25f; // real seconds between captured states
+int rewind_memory_mb = 256;
+
+// orbit prediction for one body, integrated ahead on its own thread by OrbitPredictor
+bool show_prediction = false;
+float prediction_days = 30.0f;
+int prediction_massive = 64; // heaviest bodies kept in the reduced model
+float prediction_refresh = 0.5f; // real seconds between refreshes while the simulation runs
+
+// zones recorded by Tracer on every thread, shown as a timeline and exported for chrome://tracing
+bool trace_enabled = true;
+bool trace_freeze = false; // keep showing the same frames
+int trace_frames = 2; // complete frames in the timeline
+char trace_path[256] = "trace.json";
+bool counters_enabled = false; // hardware counters per phase and thread, see PerfCounters
 
 double totalElapsedTime = 0.0; // simulation time
 double realTimeElapsed = 0.0;
@@ -105,6 +205,11 @@ void createSphereMesh(std::vector<float>& vertices, std::vector<unsigned int>& i
             vertices.push_back(xSegment); // R
             vertices.push_back(ySegment); // G
             vertices.push_back(1.0f - ySegment); // B
+            vertices.push_back(xSegment); // U
+            vertices.push_back(ySegment); // V
+            vertices.push_back(xPos / radius); // normal of a sphere centered on the origin
+            vertices.push_back(yPos / radius);
+            vertices.push_back(zPos / radius);
         }
     }
 
@@ -129,83 +234,11 @@ public:
     double radius;
     double mass;
     glm::vec3 color;
-    VAO vao;
-    VBO* vbo;
-    EBO* ebo;
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
+    int meshId = SPHERE_MESH;
+    int textureId = -1; // TextureManager handle, or -1 for an untextured body
 
     CelestialBody(const dvec3& pos, const dvec3& vel, double r, double m, const glm::vec3& col)
-        : position(pos), velocity(vel), force(0.0, 0.0, 0.0), radius(r), mass(m), color(col), vbo(nullptr), ebo(nullptr) {
-        double renderScale = 1e-3; // Adjust this factor to make bodies visible
-        createSphereMesh(vertices, indices, static_cast<float>(radius * renderScale), 10);
-
-        if (vertices.empty() || indices.empty()) {
-            throw std::runtime_error("Failed to create sphere mesh");
-        }
-
-        vbo = new VBO(vertices.data(), vertices.size() * sizeof(float));
-        ebo = new EBO(indices.data(), indices.size() * sizeof(unsigned int));
-        vao.Bind();
-        vao.LinkAttrib(*vbo, 0, 3, GL_FLOAT, 6 * sizeof(float), (void*)0);
-        vao.LinkAttrib(*vbo, 1, 3, GL_FLOAT, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-        vao.Unbind();
-        vbo->Unbind();
-        ebo->Unbind();
-    }
-
-    ~CelestialBody() {
-        delete vbo;
-        delete ebo;
-    }
-
-    // Prevent copying
-    CelestialBody(const CelestialBody&) = delete;
-    CelestialBody& operator=(const CelestialBody&) = delete;
-
-    CelestialBody(CelestialBody&& other) noexcept
-        : position(other.position), velocity(other.velocity), force(other.force),
-          radius(other.radius), mass(other.mass), color(other.color),
-          vao(std::move(other.vao)), vbo(other.vbo), ebo(other.ebo),
-          vertices(std::move(other.vertices)), indices(std::move(other.indices)) {
-        other.vbo = nullptr;
-        other.ebo = nullptr;
-    }
-
-    CelestialBody& operator=(CelestialBody&& other) noexcept {
-        if (this != &other) {
-            delete vbo;
-            delete ebo;
-            position = other.position;
-            velocity = other.velocity;
-            force = other.force;
-            radius = other.radius;
-            mass = other.mass;
-            color = other.color;
-            vao = std::move(other.vao);
-            vbo = other.vbo;
-            ebo = other.ebo;
-            vertices = std::move(other.vertices);
-            indices = std::move(other.indices);
-            other.vbo = nullptr;
-            other.ebo = nullptr;
-        }
-        return *this;
-    }
-
-    void draw(Shader& shader) {
-        shader.Activate();
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(position));  // Convert to float for rendering
-        shader.setMat4("model", model);
-        shader.setVec3("color", color);
-
-        vao.Bind();
-        ebo->Bind();
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        ebo->Unbind();
-        vao.Unbind();
-    }
+        : position(pos), velocity(vel), force(0.0, 0.0, 0.0), radius(r), mass(m), color(col) {}
 
     void update(double dt) { // this uses verlet integration
         // First half of position update
@@ -222,20 +255,25 @@ public:
     }
 };
 
+constexpr uint32_t noNode = UINT32_MAX;
+constexpr uint32_t noBody = UINT32_MAX;
+
+// Node of the Barnes-Hut tree. Nodes live in the tree's pool and point at each other by index,
+// so rebuilding the tree reuses the pool instead of allocating every node again.
 class OctreeNode {
 public:
     dvec3 center;
     double size;
     dvec3 centerOfMass;
     double totalMass;
-    std::vector<CelestialBody*> bodies;
-    std::unique_ptr<OctreeNode> children[8];
+    uint32_t firstChild = noNode; // pool index of the first of eight consecutive children
+    uint32_t firstBody = noBody; // dense index of the leaf's body; more follow in Octree::nextBody once the leaf is too small to split
 
     OctreeNode(const dvec3& center, double size)
         : center(center), size(size), centerOfMass(0.0, 0.0, 0.0), totalMass(0.0) {}
 
     bool isLeaf() const {
-        return children[0] == nullptr;
+        return firstChild == noNode;
     }
 
     int getOctant(const dvec3& position) const {
@@ -245,54 +283,21 @@ public:
         if (position.z >= center.z) octant |= 1;
         return octant;
     }
+};
 
-    void insert(CelestialBody* body) {
-        if (isLeaf() && bodies.empty()) {
-            bodies.push_back(body);
-            centerOfMass = body->position;
-            totalMass = body->mass;
-        } else {
-            if (isLeaf() && bodies.size() == 1) {
-                CelestialBody* existingBody = bodies[0];
-                bodies.clear();
-                subdivide();
-                insertToChild(existingBody);
-            }
-
-            // Add a base case to stop recursion
-            if (size > MIN_NODE_SIZE) {
-                insertToChild(body);
-            } else {
-                bodies.push_back(body);
-            }
-
-            // Update center of mass and total mass
-            dvec3 weightedPos = centerOfMass * totalMass + body->position * body->mass;
-            totalMass += body->mass;
-            centerOfMass = weightedPos / totalMass;
-        }
-    }
-
-private:
-    void subdivide() {
-        double childSize = size / 2.0;
-        for (int i = 0; i < 8; ++i) {
-            dvec3 childCenter = center;
-            childCenter.x += ((i & 4) ? childSize : -childSize) / 2.0;
-            childCenter.y += ((i & 2) ? childSize : -childSize) / 2.0;
-            childCenter.z += ((i & 1) ? childSize : -childSize) / 2.0;
-            children[i] = std::make_unique<OctreeNode>(childCenter, childSize);
-        }
-    }
-
-    void insertToChild(CelestialBody* body) {
-        int octant = getOctant(body->position);
-        children[octant]->insert(body);
+// picks the sphere level of detail for a body of the given scale seen from the given distance
+GLuint sphereLodFor(float scale, float distance) {
+    float apparentSize = scale / std::max(distance, 1e-6f);
+    GLuint lod = 0;
+    while (lod < 2 && apparentSize < sphereLodThresholds[lod]) {
+        lod++;
     }
-};
+    return lod;
+}
 
-void createNewBody(std::vector<CelestialBody>& celestialBodies) {
-    celestialBodies.emplace_back(
+BodyHandle createNewBody(BodyStore<CelestialBody>& celestialBodies) {
+    bodiesChanged = true;
+    return celestialBodies.Emplace(
         new_body_position,
         new_body_velocity,
         new_body_radius,
@@ -301,12 +306,27 @@ void createNewBody(std::vector<CelestialBody>& celestialBodies) {
     );
 }
 
-class Octree {
+// Barnes-Hut tree over the body store. Nodes hold dense indices, which stay valid until a body is removed:
+// bodies added in between are inserted as they arrive, removals mark the tree for a rebuild.
+class Octree : public BodyStoreListener {
 public:
-    std::unique_ptr<OctreeNode> root;
+    std::vector<OctreeNode> nodes; // nodes[0] is the root; the capacity stays between rebuilds
+    std::vector<uint32_t> nextBody; // next body in the same leaf, per dense index
+    bool stale = true; // rebuild before the next force pass
 
-    void build(const std::vector<CelestialBody>& bodies) {
-        if (bodies.empty()) return;
+    explicit Octree(BodyStore<CelestialBody>& bodies) : bodies(bodies) {
+        bodies.AddListener(this);
+    }
+    ~Octree() override {
+        bodies.RemoveListener(this);
+    }
+    Octree(const Octree&) = delete;
+    Octree& operator=(const Octree&) = delete;
+
+    void build() {
+        stale = false;
+        nodes.clear();
+        if (bodies.Empty()) return;
 
         // Find bounding box
         dvec3 min = bodies[0].position, max = bodies[0].position;
@@ -318,16 +338,104 @@ public:
         dvec3 center = (min + max) * 0.5;
         double size = glm::length(max - min) * 0.5;
 
-        root = std::make_unique<OctreeNode>(center, size);
+        nodes.emplace_back(center, size);
+        nextBody.resize(bodies.Size());
 
-        for (const auto& body : bodies) {
-            root->insert(const_cast<CelestialBody*>(&body));
+        for (size_t i = 0; i < bodies.Size(); i++) {
+            insert(0, static_cast<uint32_t>(i));
+        }
+    }
+
+    // The pool, or nullptr before the first build
+    const OctreeNode* root() const {
+        return nodes.empty() ? nullptr : nodes.data();
+    }
+
+    // Bytes the tree holds on to, used or not
+    size_t MemoryBytes() const {
+        return nodes.capacity() * sizeof(OctreeNode) + nextBody.capacity() * sizeof(uint32_t);
+    }
+
+    // New bodies inside the root's cube go straight into the tree; one outside it needs a larger root
+    void BodiesInserted(size_t first, size_t count) override {
+        if (stale || nodes.empty()) {
+            stale = true;
+            return;
+        }
+        for (size_t i = first; i < first + count; i++) {
+            dvec3 offset = glm::abs(bodies[i].position - nodes[0].center);
+            if (std::max(offset.x, std::max(offset.y, offset.z)) > nodes[0].size) {
+                stale = true;
+                return;
+            }
         }
+        nextBody.resize(bodies.Size());
+        for (size_t i = first; i < first + count; i++) {
+            insert(0, static_cast<uint32_t>(i));
+        }
+    }
+
+    void BodiesRemoved() override {
+        stale = true;
+    }
+
+private:
+    // Nodes are addressed by index throughout: subdividing may move the whole pool
+    void insert(uint32_t node, uint32_t index) {
+        const CelestialBody& body = bodies[index];
+        if (nodes[node].isLeaf() && nodes[node].firstBody == noBody) {
+            nodes[node].firstBody = index;
+            nextBody[index] = noBody;
+            nodes[node].centerOfMass = body.position;
+            nodes[node].totalMass = body.mass;
+            return;
+        }
+
+        // Add a base case to stop recursion: below the minimum size a leaf keeps every body that lands in it
+        if (nodes[node].isLeaf() && nodes[node].size > MIN_NODE_SIZE) {
+            uint32_t existingBody = nodes[node].firstBody;
+            nodes[node].firstBody = noBody;
+            subdivide(node);
+            insertToChild(node, existingBody);
+        }
+        if (nodes[node].isLeaf()) {
+            nextBody[index] = nodes[node].firstBody;
+            nodes[node].firstBody = index;
+        } else {
+            insertToChild(node, index);
+        }
+
+        // Update center of mass and total mass
+        OctreeNode& updated = nodes[node];
+        dvec3 weightedPos = updated.centerOfMass * updated.totalMass + body.position * body.mass;
+        updated.totalMass += body.mass;
+        updated.centerOfMass = weightedPos / updated.totalMass;
     }
+
+    void subdivide(uint32_t node) {
+        uint32_t firstChild = static_cast<uint32_t>(nodes.size());
+        double childSize = nodes[node].size / 2.0;
+        for (int i = 0; i < 8; ++i) {
+            dvec3 childCenter = nodes[node].center;
+            childCenter.x += ((i & 4) ? childSize : -childSize) / 2.0;
+            childCenter.y += ((i & 2) ? childSize : -childSize) / 2.0;
+            childCenter.z += ((i & 1) ? childSize : -childSize) / 2.0;
+            nodes.emplace_back(childCenter, childSize);
+        }
+        nodes[node].firstChild = firstChild;
+    }
+
+    void insertToChild(uint32_t node, uint32_t index) {
+        int octant = nodes[node].getOctant(bodies[index].position);
+        insert(nodes[node].firstChild + octant, index);
+    }
+
+    BodyStore<CelestialBody>& bodies;
 };
 
-void calculateForce(CelestialBody* body, const OctreeNode* node) {
-    if (node->isLeaf() && node->bodies.empty()) {
+void calculateForce(CelestialBody* body, const OctreeNode* nodes, uint32_t index) {
+    const OctreeNode* node = &nodes[index];
+    if (node->isLeaf() && node->firstBody == noBody) {
         return;
     }
 
@@ -340,49 +448,102 @@ void calculateForce(CelestialBody* body, const OctreeNode* node) {
         body->force += direction * forceMagnitude;
     } else {
         for (int i = 0; i < 8; ++i) {
-            if (node->children[i]) {
-                calculateForce(body, node->children[i].get());
-            }
+            calculateForce(body, nodes, node->firstChild + i);
         }
     }
 }
 
-void calculateForcesNormal(std::vector<CelestialBody>& bodies, const OctreeNode* root) {
+void calculateForcesNormal(BodyStore<CelestialBody>& bodies, const OctreeNode* root) {
     for (auto & body : bodies) {
-        calculateForce(&body, root);
+        calculateForce(&body, root, 0);
     }
 }
 
-void calculateForcesThreads(std::vector<CelestialBody>& bodies, const OctreeNode* root) {
+void calculateForcesThreads(BodyStore<CelestialBody>& bodies, const OctreeNode* root) {
     const size_t numThreads = std::thread::hardware_concurrency();
     std::vector<std::thread> threads;
 
     auto worker = [&](size_t start, size_t end) {
         for (size_t i = start; i < end; ++i) {
-            calculateForce(&bodies[i], root);
+            calculateForce(&bodies[i], root, 0);
         }
     };
 
-    size_t chunkSize = bodies.size() / numThreads;
+    size_t chunkSize = bodies.Size() / numThreads;
     for (size_t i = 0; i < numThreads - 1; ++i) {
         threads.emplace_back(worker, i * chunkSize, (i + 1) * chunkSize);
     }
-    threads.emplace_back(worker, (numThreads - 1) * chunkSize, bodies.size());
+    threads.emplace_back(worker, (numThreads - 1) * chunkSize, bodies.Size());
 
     for (auto& thread : threads) {
         thread.join();
     }
 }
 
-void calculateForcesOmp(std::vector<CelestialBody>& bodies, const OctreeNode* root) {
-    #pragma omp parallel for
-    for (auto & body : bodies) {
-        calculateForce(&body, root);
+void calculateForcesOmp(BodyStore<CelestialBody>& bodies, const OctreeNode* root) {
+    #pragma omp parallel
+    {
+        // One zone per worker shows how evenly the tree walk is spread over the threads
+        TraceZone zone("Force worker");
+        CounterZone counters("Forces");
+        #pragma omp for
+        for (long long i = 0; i < static_cast<long long>(bodies.Size()); i++) {
+            calculateForce(&bodies[i], root, 0);
+        }
+    }
+}
+
+// One physics tick: rebuilds the octree when it is due, then runs every substep's force pass and integration.
+// Phase lengths go to stats and to the globals the frame governor reads.
+void physicsTick(Octree& octree, int& ticksSinceRebuild, double stepLength, FrameStats& stats) {
+    previousPositions.resize(celestialBodies.Size());
+    for (size_t i = 0; i < celestialBodies.Size(); i++) {
+        previousPositions[i] = celestialBodies[i].position;
+    }
+
+    // BUILD OCTREE
+    if (octree.stale || ticksSinceRebuild >= stepsPerOctreeRebuild) {
+        TraceZone zone("Octree build");
+        {
+            CounterZone counters("Octree build");
+            AllocationZone allocations("Octree build");
+            octree.build();
+        }
+        octree_build_ms = static_cast<float>(zone.End());
+        stats.Add("Octree build", octree_build_ms);
+        ticksSinceRebuild = 0;
+    }
+    ticksSinceRebuild++;
+
+    // DO PHYSICS
+    for (int i = 0; i < stepsPerVisualFrame; i++) { // Subdivide each tick into smaller slices if necessary
+        // CALCULATE RELATIVE FORCES FOR ALL BODIES
+        TraceZone forceZone("Forces");
+        {
+            AllocationZone allocations("Forces");
+            calculateForcesOmp(celestialBodies, octree.root());
+        }
+        force_calculation_ms = static_cast<float>(forceZone.End());
+        stats.Add("Forces", force_calculation_ms);
+
+        // UPDATE VELOCITY AND POSITION FOR ALL BODIES
+        TraceZone updateZone("Integrate");
+        {
+            CounterZone counters("Integrate");
+            AllocationZone allocations("Integrate");
+            for (auto& body : celestialBodies) {
+                body.update(stepLength);
+            }
+        }
+        totalElapsedTime += stepLength;
+        vel_pos_update_ms = static_cast<float>(updateZone.End());
+        stats.Add("Integrate", vel_pos_update_ms);
     }
 }
 
 void create_sun() {
-    celestialBodies.emplace_back(
+    bodiesChanged = true;
+    celestialBodies.Emplace(
         dvec3(0.0, 0.0, 0.0),  // Position in megameters
         dvec3(0.0, 0.0, 0.0),  // Velocity in megameters/sec
         695.7 * std::cbrt(objectSize), // radius, not important
@@ -392,7 +553,8 @@ void create_sun() {
 }
 
 void create_earth() {
-    celestialBodies.emplace_back(
+    bodiesChanged = true;
+    celestialBodies.Emplace(
         dvec3(149598, 0.0, 0.0),  // Position in megameters
         dvec3(0.0, 0.0, std::sqrt(G * 1988000 / 149598)),  // calculated orbital velocity in megameters/s
         6.37814 * std::cbrt(objectSize), // radius, not important
@@ -401,35 +563,715 @@ void create_earth() {
     );
 }
 
-void create_10000() {
-    std::uniform_real_distribution unif(1e-6, 1e-3);  // Mass range in Rg
+void create_ships(int count) {
+    bodiesChanged = true;
+    std::uniform_real_distribution unif(1e-12, 1e-10);  // Mass range in Rg, a few thousand tonnes
     std::default_random_engine re;
 
-    for (int i = 0; i < 10000; ++i) {
-        glm::dvec3 position = glm::sphericalRand(150.0);  // Positions up to 150 Mm
+    std::vector<CelestialBody> ships;
+    ships.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        glm::dvec3 position = glm::sphericalRand(200.0);  // Positions up to 200 Mm
         glm::dvec3 toCenter = dvec3(0.0f, 0.0f, 0.0f) - position;
-        glm::dvec3 velocity = glm::cross(glm::dvec3(0.0, 0.0, 1.0), toCenter);
+        glm::dvec3 velocity = glm::cross(glm::dvec3(0.0, 1.0, 0.0), toCenter);
 
         velocity = glm::normalize(velocity) * sqrt(G * 1.989 / glm::length(toCenter));
 
-        double mass = unif(re);
-        celestialBodies.emplace_back(
+        ships.emplace_back(
             position,
             velocity,
-            std::cbrt(mass * objectSize),
+            500.0, // radius, only used to size the model
+            unif(re),
+            glm::vec3(0.7f, 0.8f, 0.9f)
+        );
+        ships.back().meshId = shipMeshId;
+    }
+    celestialBodies.Insert(ships.data(), ships.size());
+}
+
+// Copies the simulation into the column layout of a snapshot. With query, the handles and force magnitudes
+// the body editor's query needs are taken in the same pass.
+SnapshotData captureSnapshot(BodyQuerySource* query = nullptr) {
+    SnapshotData data;
+    data.simulationTime = totalElapsedTime;
+    data.parameters = {time_step, theta, physicsRate, stepsPerOctreeRebuild, stepsPerVisualFrame};
+    data.Resize(celestialBodies.Size());
+    if (query != nullptr) {
+        query->handles.resize(celestialBodies.Size());
+        query->forces.resize(celestialBodies.Size());
+        query->revision = celestialBodies.Revision();
+    }
+    for (size_t i = 0; i < celestialBodies.Size(); i++) {
+        const CelestialBody& body = celestialBodies[i];
+        if (query != nullptr) {
+            query->handles[i] = celestialBodies.HandleAt(i);
+            query->forces[i] = glm::length(body.force);
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            data.positions[3 * i + axis] = body.position[axis];
+            data.velocities[3 * i + axis] = body.velocity[axis];
+            data.colors[3 * i + axis] = body.color[axis];
+        }
+        data.masses[i] = body.mass;
+        data.radii[i] = body.radius;
+        data.meshIds[i] = body.meshId;
+    }
+    return data;
+}
+
+// One capture shared by the rewind buffer and the body editor's query
+std::shared_ptr<const BodyQuerySource> captureBodies() {
+    auto source = std::make_shared<BodyQuerySource>();
+    source->state = std::make_shared<const SnapshotData>(captureSnapshot(source.get()));
+    return source;
+}
+
+// Builds bodies from snapshot columns; radii, colors and meshes are optional. Safe to call from a job thread.
+std::vector<CelestialBody> bodiesFromColumns(size_t count, const double* positions, const double* velocities, const double* masses,
+                                             const double* radii, const float* colors, const int32_t* meshIds) {
+    std::vector<CelestialBody> batch;
+    batch.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        double mass = masses[i];
+        batch.emplace_back(
+            dvec3(positions[3 * i], positions[3 * i + 1], positions[3 * i + 2]),
+            dvec3(velocities[3 * i], velocities[3 * i + 1], velocities[3 * i + 2]),
+            radii != nullptr ? radii[i] : std::cbrt(mass * objectSize),
             mass,
-            glm::vec3(1.0f, 0.9f, 0.2f)
+            colors != nullptr ? glm::vec3(colors[3 * i], colors[3 * i + 1], colors[3 * i + 2]) : glm::vec3(1.0f, 0.9f, 0.2f)
         );
+        // the ship is the only loaded model; anything else falls back to spheres
+        if (meshIds != nullptr && meshIds[i] == shipMeshId) {
+            batch.back().meshId = shipMeshId;
+        }
+    }
+    return batch;
+}
+
+// Replaces every body with bodies built from snapshot columns
+void loadBodies(size_t count, const double* positions, const double* velocities, const double* masses,
+                const double* radii, const float* colors, const int32_t* meshIds) {
+    std::vector<CelestialBody> batch = bodiesFromColumns(count, positions, velocities, masses, radii, colors, meshIds);
+    celestialBodies.Clear();
+    celestialBodies.Insert(batch.data(), batch.size());
+    bodiesChanged = true;
+}
+
+// Bodies prepared by a job, added to the simulation by commitLoadedBodies at a frame boundary
+struct LoadedBodies {
+    std::vector<CelestialBody> bodies;
+    bool replace = false; // remove the current bodies first
+    bool restoreState = false; // also take over the simulated time and settings below, as a snapshot does
+    double simulationTime = 0.0;
+    SimulationParameters parameters = {};
+};
+
+// Adds prepared bodies to the simulation; must run on the main thread
+void commitLoadedBodies(const LoadedBodies& loaded) {
+    if (loaded.replace) {
+        celestialBodies.Clear();
+        totalElapsedTime = 0.0;
+    }
+    celestialBodies.Insert(loaded.bodies.data(), loaded.bodies.size());
+    bodiesChanged = true;
+    if (loaded.restoreState) {
+        totalElapsedTime = loaded.simulationTime;
+        time_step = loaded.parameters.timeStep;
+        theta = loaded.parameters.theta;
+        physicsRate = loaded.parameters.physicsRate;
+        stepsPerOctreeRebuild = loaded.parameters.stepsPerOctreeRebuild;
+        stepsPerVisualFrame = loaded.parameters.stepsPerVisualFrame;
+    }
+}
+
+// Builds the bodies of one of the InitialConditions models on every core
+bool generateBodies(const GeneratorOptions& options, LoadedBodies& out, std::atomic<float>* progress) {
+    SnapshotData generated;
+    generateInitialConditions(options, generated, progress);
+    out.bodies = bodiesFromColumns(generated.BodyCount(), generated.positions.data(), generated.velocities.data(),
+                                   generated.masses.data(), nullptr, nullptr, nullptr);
+    return true;
+}
+
+// The generator settings chosen in the UI
+GeneratorOptions generatorOptions() {
+    GeneratorOptions options;
+    options.model = static_cast<GeneratorModel>(generator_model);
+    options.count = static_cast<size_t>(std::max(generator_count, 0));
+    options.seed = static_cast<uint64_t>(generator_seed);
+    options.scaleRadius = generator_radius;
+    options.totalMass = generator_mass;
+    options.gravity = G;
+    return options;
+}
+
+// Reads initial conditions from a Gadget-2, CSV or columnar binary file in the given import_units setting
+bool importBodies(const std::string& path, int units, LoadedBodies& out) {
+    bool gadget = units == 2 || (units == 0 && particleFormat(path) == particleFormatGadget);
+    SnapshotData imported;
+    std::string error;
+    if (!importParticles(path, gadget ? gadgetUnits() : simulationUnits(), imported, error)) {
+        std::cout << "Could not import " << path << ": " << error << std::endl;
+        return false;
+    }
+    out.bodies = bodiesFromColumns(imported.BodyCount(), imported.positions.data(), imported.velocities.data(), imported.masses.data(),
+                                   imported.radii.empty() ? nullptr : imported.radii.data(), nullptr, nullptr);
+    return true;
+}
+
+// Reads a snapshot file, straight from the mapping, into bodies that replace the simulation along with its settings.
+// Textures are not part of snapshots, so restored bodies are untextured.
+bool readSnapshot(const std::string& path, LoadedBodies& out) {
+    SnapshotFile snapshot(path.c_str());
+    if (!snapshot.Valid()) {
+        std::cout << "Could not load snapshot " << path << ": " << snapshot.Error() << std::endl;
+        return false;
+    }
+    const double* positions = snapshot.Positions();
+    const double* velocities = snapshot.Velocities();
+    const double* masses = snapshot.Masses();
+    if (positions == nullptr || velocities == nullptr || masses == nullptr) {
+        std::cout << "Could not load snapshot " << path << ": positions, velocities or masses are missing" << std::endl;
+        return false;
+    }
+
+    out.bodies = bodiesFromColumns(snapshot.BodyCount(), positions, velocities, masses,
+                                   snapshot.Radii(), snapshot.Colors(), snapshot.MeshIds());
+    out.replace = true;
+    out.restoreState = true;
+    out.simulationTime = snapshot.SimulationTime();
+    out.parameters = snapshot.Parameters();
+    return true;
+}
+
+// Runs read on a job thread and adds its bodies at the start of a later frame; the old trails are dropped then
+void submitLoad(JobSystem& jobs, TrailRenderer& trails, const std::string& name, bool replace, std::function<bool(LoadedBodies&, JobProgress&)> read) {
+    auto loaded = std::make_shared<LoadedBodies>();
+    jobs.Submit(name,
+        [loaded, replace, read](JobProgress& progress) {
+            bool succeeded = read(*loaded, progress);
+            loaded->replace |= replace;
+            return succeeded;
+        },
+        [loaded, &trails]() {
+            commitLoadedBodies(*loaded);
+            trails.Reset();
+        });
+}
+
+// Goes back to a state from the rewind buffer. Settings stay as they are, so the run can be retried with different ones.
+// Bodies keep their textures as long as the body count did not change.
+void restoreRewindState(const SnapshotData& state) {
+    std::vector<int> textureIds;
+    if (state.BodyCount() == celestialBodies.Size()) {
+        for (const auto& body : celestialBodies) {
+            textureIds.push_back(body.textureId);
+        }
+    }
+    loadBodies(state.BodyCount(), state.positions.data(), state.velocities.data(), state.masses.data(),
+               state.radii.data(), state.colors.data(), state.meshIds.data());
+    for (size_t i = 0; i < textureIds.size(); i++) {
+        celestialBodies[i].textureId = textureIds[i];
     }
+    totalElapsedTime = state.simulationTime;
 }
 
-int main() {
+// Handles of the heaviest bodies, the ones a prediction keeps in its reduced model
+std::vector<BodyHandle> heaviestBodies(size_t count) {
+    std::vector<uint32_t> order(celestialBodies.Size());
+    std::iota(order.begin(), order.end(), 0u);
+    count = std::min(count, order.size());
+    std::nth_element(order.begin(), order.begin() + count, order.end(), [](uint32_t a, uint32_t b) {
+        return celestialBodies[a].mass > celestialBodies[b].mass;
+    });
+    std::vector<BodyHandle> handles;
+    for (size_t i = 0; i < count; i++) {
+        handles.push_back(celestialBodies.HandleAt(order[i]));
+    }
+    return handles;
+}
+
+// Copies the current state of a reduced model into a request to predict the path of target
+PredictionRequest predictionRequest(BodyHandle target, const std::vector<BodyHandle>& model) {
+    PredictionRequest request;
+    request.gravity = G;
+    request.horizon = prediction_days * 86400.0;
+    for (BodyHandle handle : model) {
+        const CelestialBody* body = celestialBodies.Get(handle);
+        if (body == nullptr) {
+            continue;
+        }
+        if (handle == target) {
+            request.target = static_cast<int>(request.massive.size());
+        }
+        request.massive.push_back({body->position, body->velocity, body->mass});
+    }
+    // a light body, e.g. a ship, rides along as a test particle
+    const CelestialBody* body = celestialBodies.Get(target);
+    if (request.target < 0 && body != nullptr) {
+        request.targetPosition = body->position;
+        request.targetVelocity = body->velocity;
+    }
+    return request;
+}
+
+// CPU submit time next to GPU time for every render pass, and which of the two limits the frame
+void drawGpuPasses(const GpuTimer& timer, float cpuFrameMs) {
+    if (!timer.Available()) {
+        ImGui::Text("Waiting for the first timer results");
+        return;
+    }
+    if (ImGui::BeginTable("Render Passes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Pass");
+        ImGui::TableSetupColumn("CPU ms");
+        ImGui::TableSetupColumn("GPU ms");
+        ImGui::TableHeadersRow();
+        for (const GpuPassTime& pass : timer.Results()) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(pass.name);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.3f", pass.cpuMs);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.3f", pass.gpuMs);
+        }
+        ImGui::EndTable();
+    }
+    // The CPU side is the whole frame except waiting in the swap; whichever is longer sets the frame rate
+    ImGui::Text("GPU %.2f ms, CPU %.2f ms per frame: %s-bound (results are %d frames old%s)",
+                timer.GpuMs(), cpuFrameMs, timer.GpuMs() > cpuFrameMs ? "GPU" : "CPU", timer.Latency(),
+                timer.Dropped() > 0 ? ", some arrived too late" : "");
+}
+
+// --import <file> starts from initial conditions made by another code, e.g. a Gadget-2 snapshot.
+// --generate <model> [--count N] [--seed S] starts from a generated one, e.g. --generate plummer --count 1000000
+// --load <snapshot> restarts a saved run, e.g. the last checkpoint of a long simulation
+void loadFromArguments(int argc, char** argv) {
+    int generateModel = -1;
+    for (int i = 1; i + 1 < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--count") {
+            generator_count = std::atoi(argv[i + 1]);
+        } else if (option == "--seed") {
+            generator_seed = std::atoi(argv[i + 1]);
+        } else if (option == "--generate") {
+            for (int model = 0; model < generatorModelCount; model++) {
+                std::string name = generatorModelNames[model];
+                std::string key = argv[i + 1];
+                auto lower = [](std::string text) {
+                    text.erase(std::remove(text.begin(), text.end(), ' '), text.end());
+                    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                    return text;
+                };
+                if (lower(name) == lower(key)) {
+                    generateModel = model;
+                }
+            }
+            if (generateModel < 0) {
+                std::cout << "Unknown model " << argv[i + 1] << std::endl;
+            }
+        }
+    }
+    if (generateModel >= 0) {
+        generator_model = generateModel;
+        LoadedBodies generated;
+        generateBodies(generatorOptions(), generated, nullptr);
+        commitLoadedBodies(generated);
+    }
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--load") {
+            std::snprintf(snapshot_path, sizeof(snapshot_path), "%s", argv[i + 1]);
+            LoadedBodies loaded;
+            if (readSnapshot(snapshot_path, loaded)) {
+                commitLoadedBodies(loaded);
+            }
+        } else if (std::string(argv[i]) == "--import") {
+            std::snprintf(import_path, sizeof(import_path), "%s", argv[i + 1]);
+            LoadedBodies imported;
+            imported.replace = true;
+            if (importBodies(import_path, import_units, imported)) {
+                commitLoadedBodies(imported);
+            }
+        }
+    }
+}
+
+// Bytes the simulation itself holds, with or without a window
+std::vector<MemoryUsage> simulationMemory(const Octree& octree) {
+    return {
+        {"Bodies", celestialBodies.MemoryBytes()},
+        {"Previous positions", previousPositions.capacity() * sizeof(glm::dvec3)},
+        {"Octree", octree.MemoryBytes()},
+        {"Trace buffers", Tracer::MemoryBytes()},
+    };
+}
+
+// Where the bytes of one CelestialBody go
+std::string bodyLayout() {
+    size_t vectors = sizeof(CelestialBody::position) + sizeof(CelestialBody::velocity) + sizeof(CelestialBody::force);
+    size_t scalars = sizeof(CelestialBody::radius) + sizeof(CelestialBody::mass);
+    size_t color = sizeof(CelestialBody::color);
+    size_t ids = sizeof(CelestialBody::meshId) + sizeof(CelestialBody::textureId);
+    char text[256];
+    std::snprintf(text, sizeof(text), "CelestialBody is %zu bytes: position, velocity and force %zu, radius and mass %zu, color %zu, mesh and texture ids %zu, padding %zu",
+                  sizeof(CelestialBody), vectors, scalars, color, ids, sizeof(CelestialBody) - vectors - scalars - color - ids);
+    return text;
+}
+
+// Writes the timing statistics, hardware counters and memory of a headless run as CSV tables.
+// steadyAllocations counts the heap allocations of the ticks after the warm-up.
+bool writeHeadlessReport(const std::string& path, const FrameStats& stats, int ticks, const Octree& octree,
+                         uint64_t steadyAllocations, int allocatingTicks, int steadyTicks) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fprintf(file, "# %zu bodies, %d ticks of %d substeps, theta %.2f, %d threads\n",
+                 celestialBodies.Size(), ticks, stepsPerVisualFrame, theta, omp_get_max_threads());
+    std::fprintf(file, "phase,min_ms,mean_ms,p50_ms,p99_ms,max_ms\n");
+    for (size_t phase = 0; phase < stats.PhaseCount(); phase++) {
+        PhaseSummary summary = stats.Summary(phase);
+        std::fprintf(file, "%s,%.4f,%.4f,%.4f,%.4f,%.4f\n", stats.PhaseName(phase),
+                     summary.min, summary.mean, summary.p50, summary.p99, summary.max);
+    }
+
+    // Unsupported counters are left empty; so are the ratios built from them
+    std::fprintf(file, "\n# hardware counters: %s\n", PerfCounters::Status().c_str());
+    std::fprintf(file, "phase,thread,zones,cycles,instructions,cache_misses,branch_misses,"
+                       "ipc,cache_misses_per_kilo_instruction,branch_misses_per_kilo_instruction\n");
+    for (const PhaseCounters& total : PerfCounters::Totals()) {
+        std::fprintf(file, "%s,%s,%llu", total.phase, Tracer::ThreadName(total.thread).c_str(),
+                     static_cast<unsigned long long>(total.zones));
+        for (int counter = 0; counter < counterCount; counter++) {
+            if (PerfCounters::Supported(static_cast<PerfCounter>(counter))) {
+                std::fprintf(file, ",%llu", static_cast<unsigned long long>(total.values[counter]));
+            } else {
+                std::fprintf(file, ",");
+            }
+        }
+        double instructions = static_cast<double>(total.values[counterInstructions]);
+        bool haveInstructions = PerfCounters::Supported(counterInstructions) && instructions > 0.0;
+        auto ratio = [&](PerfCounter counter, double numerator, double denominator) {
+            if (haveInstructions && PerfCounters::Supported(counter) && denominator > 0.0) {
+                std::fprintf(file, ",%.4f", numerator / denominator);
+            } else {
+                std::fprintf(file, ",");
+            }
+        };
+        ratio(counterCycles, instructions, static_cast<double>(total.values[counterCycles]));
+        ratio(counterCacheMisses, total.values[counterCacheMisses] * 1000.0, instructions);
+        ratio(counterBranchMisses, total.values[counterBranchMisses] * 1000.0, instructions);
+        std::fprintf(file, "\n");
+    }
+
+    std::fprintf(file, "\n# %s\n", bodyLayout().c_str());
+    std::fprintf(file, "# heap allocations after warm-up: %llu in %d of %d ticks\n",
+                 static_cast<unsigned long long>(steadyAllocations), allocatingTicks, steadyTicks);
+    std::fprintf(file, "subsystem,bytes,bytes_per_body\n");
+    for (const MemoryUsage& usage : simulationMemory(octree)) {
+        std::fprintf(file, "%s,%zu,%.1f\n", usage.subsystem, usage.bytes,
+                     static_cast<double>(usage.bytes) / std::max<size_t>(celestialBodies.Size(), 1));
+    }
+    return std::fclose(file) == 0;
+}
+
+// Simulates ticks physics ticks without a window, as fast as they run, and writes a report of every phase.
+// Counters are always on here; where the kernel does not allow them the report says why and has no values.
+// With checkAllocations the run fails when a tick after the warm-up allocates.
+int runHeadless(int ticks, const std::string& reportPath, bool checkAllocations) {
+    if (celestialBodies.Empty()) {
+        std::cout << "Nothing to simulate; add bodies with --generate, --import or --load" << std::endl;
+        return 1;
+    }
+    PerfCounters::SetEnabled(true);
+    Octree octree(celestialBodies);
+    FrameStats stats(static_cast<size_t>(ticks));
+    int ticksSinceRebuild = 0;
+    double stepLength = time_step / physicsRate / stepsPerVisualFrame;
+    // The first half settles the octree pool, the OpenMP threads and every thread's trace buffer;
+    // from then on a tick should not touch the heap at all
+    int warmup = ticks / 2;
+    uint64_t steadyAllocations = 0;
+    int allocatingTicks = 0;
+    for (int tick = 0; tick < ticks; tick++) {
+        TraceZone zone("Tick");
+        AllocationZone allocations("Tick");
+        physicsTick(octree, ticksSinceRebuild, stepLength, stats);
+        AllocationCount count = allocations.End();
+        stats.Add("Tick", static_cast<float>(zone.End()));
+        stats.EndFrame();
+        MemoryStats::EndFrame();
+        if (tick >= warmup && count.allocations > 0) {
+            if (allocatingTicks == 0) {
+                std::cout << "Tick " << tick << " allocated " << count.allocations << " times:";
+                for (const PhaseAllocations& phase : MemoryStats::Phases()) {
+                    if (phase.lastFrame.allocations > 0 && std::strcmp(phase.phase, "Tick") != 0) {
+                        std::cout << " " << phase.phase << " " << phase.lastFrame.allocations;
+                    }
+                }
+                std::cout << std::endl;
+            }
+            allocatingTicks++;
+            steadyAllocations += count.allocations;
+        }
+    }
+
+    std::cout << "Hardware counters: " << PerfCounters::Status() << std::endl;
+    if (!writeHeadlessReport(reportPath, stats, ticks, octree, steadyAllocations, allocatingTicks, ticks - warmup)) {
+        std::cout << "Could not write report " << reportPath << std::endl;
+        return 1;
+    }
+    std::cout << "Simulated " << ticks << " ticks of " << celestialBodies.Size() << " bodies, report in " << reportPath << std::endl;
+    if (checkAllocations && allocatingTicks > 0) {
+        std::cout << "Allocation check failed: " << allocatingTicks << " of " << ticks - warmup
+                  << " ticks after the warm-up allocated, " << steadyAllocations << " times in total" << std::endl;
+        return 2;
+    }
+    return 0;
+}
+
+// Memory per subsystem and per body, and the heap allocations of each phase in the last frame
+void drawMemoryStats(const std::vector<MemoryUsage>& usage) {
+    double bodies = static_cast<double>(std::max<size_t>(celestialBodies.Size(), 1));
+    size_t total = 0;
+    if (ImGui::BeginTable("Memory", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Subsystem");
+        ImGui::TableSetupColumn("MB");
+        ImGui::TableSetupColumn("Bytes per body");
+        ImGui::TableHeadersRow();
+        for (const MemoryUsage& entry : usage) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(entry.subsystem);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.2f", entry.bytes / (1024.0 * 1024.0));
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.1f", entry.bytes / bodies);
+            total += entry.bytes;
+        }
+        ImGui::EndTable();
+    }
+    ImGui::Text("%.2f MB in total, %.1f bytes per body", total / (1024.0 * 1024.0), total / bodies);
+    ImGui::TextWrapped("%s", bodyLayout().c_str());
+
+    AllocationCount allocations = MemoryStats::Allocations();
+    ImGui::Text("%llu heap allocations since start, %.1f MB requested", static_cast<unsigned long long>(allocations.allocations),
+                allocations.bytes / (1024.0 * 1024.0));
+    if (ImGui::BeginTable("Allocations", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Phase");
+        ImGui::TableSetupColumn("Allocations last frame");
+        ImGui::TableSetupColumn("KB last frame");
+        ImGui::TableHeadersRow();
+        for (const PhaseAllocations& phase : MemoryStats::Phases()) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(phase.phase);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%llu", static_cast<unsigned long long>(phase.lastFrame.allocations));
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.1f", phase.lastFrame.bytes / 1024.0);
+        }
+        ImGui::EndTable();
+    }
+}
+
+// Hardware counters of every phase and thread since the last reset, with the ratios that tell memory-bound from compute-bound
+void drawPerfCounters() {
+    if (ImGui::Checkbox("Count events", &counters_enabled)) {
+        PerfCounters::SetEnabled(counters_enabled);
+    }
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Reset counters")) {
+        PerfCounters::Reset();
+    }
+    ImGui::TextWrapped("%s", PerfCounters::Status().c_str());
+    std::vector<PhaseCounters> totals = PerfCounters::Totals();
+    if (totals.empty()) {
+        return;
+    }
+    if (ImGui::BeginTable("Hardware Counters", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Phase");
+        ImGui::TableSetupColumn("Thread");
+        ImGui::TableSetupColumn("Instructions");
+        ImGui::TableSetupColumn("IPC");
+        ImGui::TableSetupColumn("Cache misses / 1k instr");
+        ImGui::TableSetupColumn("Branch misses / 1k instr");
+        ImGui::TableHeadersRow();
+        for (const PhaseCounters& total : totals) {
+            double instructions = static_cast<double>(total.values[counterInstructions]);
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(total.phase);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::TextUnformatted(Tracer::ThreadName(total.thread).c_str());
+            ImGui::TableSetColumnIndex(2);
+            if (PerfCounters::Supported(counterInstructions)) {
+                ImGui::Text("%.3g", instructions);
+            } else {
+                ImGui::TextDisabled("unsupported");
+            }
+            // a ratio needs both of its counters
+            const PerfCounter counters[] = { counterCycles, counterCacheMisses, counterBranchMisses };
+            for (int column = 0; column < 3; column++) {
+                ImGui::TableSetColumnIndex(column + 3);
+                double value = static_cast<double>(total.values[counters[column]]);
+                if (!PerfCounters::Supported(counterInstructions) || !PerfCounters::Supported(counters[column]) || instructions <= 0.0) {
+                    ImGui::TextDisabled("-");
+                } else if (column == 0) {
+                    ImGui::Text("%.2f", value > 0.0 ? instructions / value : 0.0);
+                } else {
+                    ImGui::Text("%.2f", value * 1000.0 / instructions);
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+// Rolling min/mean/p50/p99/max of every phase with its graph, and a histogram of frame times
+void drawFrameStats(FrameStats& stats) {
+    ImGui::Text("Last %d frames, in ms", stats.Count());
+    ImGui::SameLine();
+    if (ImGui::SmallButton("Reset")) {
+        stats.Reset();
+    }
+    if (stats.Count() == 0) {
+        return;
+    }
+    if (ImGui::BeginTable("Phase Statistics", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Phase");
+        ImGui::TableSetupColumn("Min");
+        ImGui::TableSetupColumn("Mean");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableSetupColumn("Max");
+        ImGui::TableSetupColumn("History", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+        for (size_t phase = 0; phase < stats.PhaseCount(); phase++) {
+            PhaseSummary summary = stats.Summary(phase);
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(stats.PhaseName(phase));
+            const float values[] = { summary.min, summary.mean, summary.p50, summary.p99, summary.max };
+            for (int column = 0; column < 5; column++) {
+                ImGui::TableSetColumnIndex(column + 1);
+                ImGui::Text("%.2f", values[column]);
+            }
+            // scaled to the max so a spike stands out against the typical frame
+            ImGui::TableSetColumnIndex(6);
+            ImGui::PushID(static_cast<int>(phase));
+            ImGui::PlotLines("##history", stats.Samples(phase), stats.Count(), stats.Offset(), nullptr,
+                             0.0f, std::max(summary.max, 0.01f), ImVec2(-1.0f, ImGui::GetTextLineHeight()));
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+
+    // Frame times up to twice the median, so the tail is visible; longer frames pile up in the last bin
+    for (size_t phase = 0; phase < stats.PhaseCount(); phase++) {
+        if (std::strcmp(stats.PhaseName(phase), "Frame") == 0) {
+            PhaseSummary summary = stats.Summary(phase);
+            float range = std::max(2.0f * summary.p50, summary.p99);
+            std::vector<float> bins;
+            stats.Histogram(phase, 40, range, bins);
+            char overlay[64];
+            std::snprintf(overlay, sizeof(overlay), "0 to %.1f ms", range);
+            ImGui::PlotHistogram("Frame times", bins.data(), static_cast<int>(bins.size()), 0, overlay,
+                                 0.0f, FLT_MAX, ImVec2(-1.0f, 80.0f));
+        }
+    }
+}
+
+// Colour of a zone, the same for every zone of that name
+ImU32 zoneColor(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c != '\0'; c++) {
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    return IM_COL32(80 + hash % 140, 80 + (hash >> 8) % 140, 80 + (hash >> 16) % 140, 255);
+}
+
+// Draws the zones in [from, to) as a timeline: one band per thread, nested zones below their parents
+void drawTimeline(const std::vector<ThreadTrace>& threads, uint64_t from, uint64_t to) {
+    if (to <= from) {
+        return;
+    }
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    const float labelWidth = 110.0f;
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = std::max(ImGui::GetContentRegionAvail().x - labelWidth, 50.0f);
+    double pixelsPerNs = width / static_cast<double>(to - from);
+    ImVec2 mouse = ImGui::GetMousePos();
+
+    float y = origin.y;
+    for (const ThreadTrace& thread : threads) {
+        uint32_t depths = 1;
+        for (const TraceEvent& event : thread.events) {
+            depths = std::max(depths, event.depth + 1);
+        }
+        drawList->AddText(ImVec2(origin.x, y + 2.0f), IM_COL32(200, 200, 200, 255), thread.name.c_str());
+        float left = origin.x + labelWidth;
+        drawList->AddRectFilled(ImVec2(left, y), ImVec2(left + width, y + depths * rowHeight), IM_COL32(30, 30, 30, 255));
+        drawList->PushClipRect(ImVec2(left, y), ImVec2(left + width, y + depths * rowHeight), true);
+        for (const TraceEvent& event : thread.events) {
+            float x0 = left + static_cast<float>((static_cast<double>(std::max(event.start, from)) - from) * pixelsPerNs);
+            float x1 = left + static_cast<float>((static_cast<double>(std::min(event.end, to)) - from) * pixelsPerNs);
+            x1 = std::max(x1, x0 + 1.0f); // short zones stay visible
+            float top = y + event.depth * rowHeight;
+            ImVec2 min(x0, top), max(x1, top + rowHeight - 1.0f);
+            drawList->AddRectFilled(min, max, zoneColor(event.name));
+            if (x1 - x0 > 30.0f) {
+                drawList->PushClipRect(min, max, true);
+                drawList->AddText(ImVec2(x0 + 2.0f, top + 1.0f), IM_COL32(0, 0, 0, 255), event.name);
+                drawList->PopClipRect();
+            }
+            if (mouse.x >= x0 && mouse.x < x1 && mouse.y >= top && mouse.y < top + rowHeight && ImGui::IsWindowHovered()) {
+                ImGui::SetTooltip("%s\n%.3f ms on %s", event.name, (event.end - event.start) / 1e6, thread.name.c_str());
+            }
+        }
+        // frame boundaries
+        for (int ago = 0; Tracer::FrameStart(ago) > from; ago++) {
+            uint64_t frameStart = Tracer::FrameStart(ago);
+            if (frameStart < to) {
+                float x = left + static_cast<float>((frameStart - from) * pixelsPerNs);
+                drawList->AddLine(ImVec2(x, y), ImVec2(x, y + depths * rowHeight), IM_COL32(255, 255, 255, 120));
+            }
+        }
+        drawList->PopClipRect();
+        y += depths * rowHeight + 4.0f;
+    }
+    ImGui::Dummy(ImVec2(labelWidth + width, y - origin.y));
+}
+
+int main(int argc, char** argv) {
+    // --headless <ticks> [--report <file>] only simulates, e.g. to profile a large run on a machine without a display.
+    // --check-allocations makes it fail when the steady-state tick allocates.
+    int headlessTicks = 0;
+    std::string reportPath = "headless.csv";
+    bool checkAllocations = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--check-allocations") {
+            checkAllocations = true;
+        } else if (i + 1 >= argc) {
+            break;
+        } else if (std::string(argv[i]) == "--headless") {
+            headlessTicks = std::max(std::atoi(argv[i + 1]), 2);
+        } else if (std::string(argv[i]) == "--report") {
+            reportPath = argv[i + 1];
+        }
+    }
+    if (headlessTicks > 0) {
+        loadFromArguments(argc, argv);
+        return runHeadless(headlessTicks, reportPath, checkAllocations);
+    }
+
     // OPENGL INITIALIZATION
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4); // 4x MSAA
+    glfwWindowHint(GLFW_SAMPLES, 0); // MSAA happens in the offscreen render target, whose sample count adapts to load
 
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Space Simulation", NULL, NULL);
     if (window == NULL) {
@@ -448,10 +1290,79 @@ int main() {
     glEnable(GL_PROGRAM_POINT_SIZE);
     Shader shader("assets/default.vert", "assets/default.frag");
     Shader pointShader("assets/point.vert", "assets/point.frag");
+    Shader skyboxShader("assets/skybox.vert", "assets/skybox.frag");
+    Shader trailShader("assets/trail.vert", "assets/trail.frag");
+    Shader pathShader("assets/path.vert", "assets/path.frag");
+
+    // body meshes are position + color + texture coordinate + normal, 11 floats per vertex, all packed into the same shared buffers
+    auto bodyMeshes = std::make_unique<BufferManager>(11 * sizeof(float), 1 << 14, 1 << 16);
+    bodyMeshes->LinkAttrib(0, 3, GL_FLOAT, 0);
+    bodyMeshes->LinkAttrib(1, 3, GL_FLOAT, 3 * sizeof(float));
+    bodyMeshes->LinkAttrib(4, 2, GL_FLOAT, 6 * sizeof(float));
+    bodyMeshes->LinkAttrib(5, 3, GL_FLOAT, 8 * sizeof(float));
+    auto bodyRenderer = std::make_unique<MeshRenderer>(*bodyMeshes, 2, 3);
+    auto textures = std::make_unique<TextureManager>();
+
+    // the starfield is generated in the background the first time and read back from disk afterwards
+    auto skybox = std::make_unique<Skybox>();
+    skybox->LoadStarfield("assets/starfield.skycache", 512, 12000, 1);
+
+    auto trails = std::make_unique<TrailRenderer>(256); // samples per body
+
+    // the scene is rendered offscreen at a resolution and sample count that keep frame time within budget
+    auto renderTarget = std::make_unique<RenderTarget>();
+    DynamicResolution dynamicResolution;
+    auto gpuTimer = std::make_unique<GpuTimer>(); // GPU time of each render pass, a few frames late
+    FrameGovernor governor;
+    FrameStats frameStats; // rolling history of the main thread's phases for the Performance window
+    BodyQuery bodyQuery;
+    std::shared_ptr<const BodyQuerySource> bodyQuerySource; // newest capture of the bodies for the editor's query
+    bool bodyQueryCaptured = false; // a capture came in that the query has not been run over yet
+
+    // unit spheres for every level of detail; their ids are their index in sphereLodSegments
+    for (int segments : sphereLodSegments) {
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        createSphereMesh(vertices, indices, 1.0f, segments);
+        bodyRenderer->AddMesh(bodyMeshes->Allocate(vertices.data(), vertices.size() / 11, indices.data(), indices.size()));
+    }
+
+    MeshData shipMesh;
+    if (loadObjMesh("assets/spaceship.obj", shipMesh)) {
+        shipMeshId = bodyRenderer->AddMesh(bodyMeshes->Allocate(shipMesh.vertices.data(), shipMesh.vertices.size() / 11,
+                                                                 shipMesh.indices.data(), shipMesh.indices.size()));
+    }
+
+    // checkpoints, recordings and rewind history, all compressed and written in the background
+    SnapshotWriter snapshotWriter;
+    double lastCheckpoint = 0.0;
+    TrajectoryWriter trajectory;
+    int ticksSinceTrajectoryFrame = 0;
+    RewindBuffer rewind(static_cast<size_t>(rewind_memory_mb) * 1024 * 1024);
+    double lastRewindCapture = -1.0;
+    int rewindSelection = 0;
+    std::unique_ptr<TrajectoryReader> playback;
+    float playbackFrame = 0.0f; // fractional frame, rendering blends the two frames around it
+    float lastPlaybackFrame = -1.0f;
+    bool playbackPlaying = false;
+    std::vector<double> playbackPositions[2]; // decoded frames around playbackFrame
+    size_t playbackLoaded[2] = {SIZE_MAX, SIZE_MAX};
+    loadFromArguments(argc, argv);
 
     std::vector<float> pointVertices;
     VAO pointVAO;
-    VBO* pointVBO = nullptr;
+    std::unique_ptr<VBO> pointVBO;
+
+    // the predicted path of the selected body, drawn as a line strip
+    OrbitPredictor predictor;
+    BodyHandle predictionTarget;
+    std::vector<BodyHandle> predictionModel;
+    bool predictionChanged = false; // the target, the settings or the bodies changed since the last request
+    float lastPrediction = 0.0f;
+    std::vector<glm::dvec3> predictedPath;
+    std::vector<float> pathVertices;
+    VAO pathVAO;
+    std::unique_ptr<VBO> pathVBO;
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
@@ -471,9 +1382,8 @@ int main() {
 
     // create initial bodies
     // create_sun();
-    // create_10000();
 
-    int numObjects = celestialBodies.size();
+    int numObjects = celestialBodies.Size();
 
     // Camera setup
     Camera camera(SCR_WIDTH, SCR_HEIGHT, glm::vec3(0.0f, 0.0f, 150.0f));
@@ -502,72 +1412,121 @@ int main() {
     glm::vec3 lightPos(10.0f, 10.0f, 10.0f);
     shader.Activate();
     shader.setVec3("lightPos", lightPos);
+    shader.setInt("bodyTexture", 0);
 
     float lastFrame = 0.0f;
-    Octree octree;
+    Octree octree(celestialBodies);
+    JobSystem jobs; // generating, importing and loading run here; results are added at the start of a frame
+
+    // what the Performance window shows of the tracer
+    std::vector<ThreadTrace> timeline;
+    std::vector<ZoneTotal> zoneTotals;
+    uint64_t timelineFrom = 0, timelineTo = 0;
 
     int time_since_last_rebuild = 0;
+    double lastInterpolation = -1.0;
+    glm::vec3 lastCameraPosition(0.0f), lastCameraOrientation(0.0f);
+    int quietFrames = 0; // consecutive paused frames in which nothing changed
+    bool waitedForEvents = false;
+    double tickAccumulator = 0.0; // real seconds not yet simulated
+    double tickInterpolation = 1.0; // how far rendering is between the previous and the current physics state
+    float swapMs = 0.0f;
+    float cpuFrameMs = 0.0f; // the last frame without waiting for the swap, to compare with GPU time
 
     // MAIN LOOP
     while (!glfwWindowShouldClose(window)) {
         // FRAME COUNTING
-        auto bigStart = std::chrono::high_resolution_clock::now();
+        Tracer::BeginFrame();
+        TraceZone frameZone("Frame");
+        AllocationZone frameAllocations("Frame");
         float currentFrame = static_cast<float>(glfwGetTime());
         float deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        std::chrono::time_point<std::chrono::system_clock> start;
-        std::chrono::time_point<std::chrono::system_clock> finish;
-        long int time;
-
-        octree.build(celestialBodies);
+        // Bodies from finished jobs join between frames, never while physics or the UI is using the store
+        {
+            TraceZone zone("Commit jobs");
+            AllocationZone allocations("Commit jobs");
+            jobs.CommitFinished();
+        }
 
-        if (!isPaused) {
-            frameSimTime = deltaTime * time_step;
+        int physicsTicks = 0;
+        if (!isPaused && playback == nullptr) {
+            TraceZone physicsZone("Physics");
+            AllocationZone physicsAllocations("Physics");
             realTimeElapsed += deltaTime;
-            // BUILD OCTREE
-            if (time_since_last_rebuild >= stepsPerOctreeRebuild) {
-                auto start = std::chrono::high_resolution_clock::now();
-                octree.build(celestialBodies);
-                auto finish = std::chrono::high_resolution_clock::now();
-                octree_build_time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start).count();
-                time_since_last_rebuild = 0;
-                std::cout << "octree build time: " << octree_build_time << std::endl;
-            }
-            time_since_last_rebuild++;
-
-            // DO PHYSICS
-            for (int i = 0; i < stepsPerVisualFrame; i++) { // Subdivide simulation into smaller slices if necessary
-                // CALCULATE RELATIVE FORCES FOR ALL BODIES
-                auto start = std::chrono::high_resolution_clock::now();
-                calculateForcesOmp(celestialBodies, octree.root.get());
-                auto finish = std::chrono::high_resolution_clock::now();
-                force_calculation_time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start).count();
-
-                // UPDATE VELOCITY AND POSITION FOR ALL BODIES
-                start = std::chrono::high_resolution_clock::now();
-                for (auto& body : celestialBodies) {
-                    body.update(deltaTime * time_step / stepsPerVisualFrame);
+            double tickLength = 1.0 / physicsRate;
+            double stepLength = time_step / physicsRate / stepsPerVisualFrame;
+            tickAccumulator = std::min(tickAccumulator + deltaTime, maxTicksPerFrame * tickLength);
+            while (tickAccumulator >= tickLength) {
+                tickAccumulator -= tickLength;
+                physicsTicks++;
+                TraceZone tickZone("Tick");
+                physicsTick(octree, time_since_last_rebuild, stepLength, frameStats);
+
+                // RECORD TRAJECTORY
+                if (trajectory.IsOpen() && ++ticksSinceTrajectoryFrame >= trajectory_cadence) {
+                    ticksSinceTrajectoryFrame = 0;
+                    TraceZone zone("Record trajectory");
+                    // Copying is all the simulation pays; a frame the writer has no room for is dropped, never waited for
+                    if (TrajectoryFrame* frame = trajectory.BeginFrame()) {
+                        bool velocities = trajectory.RecordsVelocities();
+                        frame->simulationTime = totalElapsedTime;
+                        frame->positions.resize(celestialBodies.Size() * 3);
+                        frame->velocities.resize(velocities ? celestialBodies.Size() * 3 : 0);
+                        #pragma omp parallel for
+                        for (long long b = 0; b < static_cast<long long>(celestialBodies.Size()); b++) {
+                            for (int axis = 0; axis < 3; axis++) {
+                                frame->positions[3 * b + axis] = celestialBodies[b].position[axis];
+                                if (velocities) {
+                                    frame->velocities[3 * b + axis] = celestialBodies[b].velocity[axis];
+                                }
+                            }
+                        }
+                        trajectory.Submit();
+                    }
                 }
-                totalElapsedTime += deltaTime * time_step / stepsPerVisualFrame;
-                finish = std::chrono::high_resolution_clock::now();
-                vel_pos_update_time = std::chrono::duration_cast<std::chrono::microseconds>(finish - start).count();
             }
+            frameSimTime = physicsTicks * time_step / physicsRate;
+
+            // Rewind history: copying is all this frame pays, compression happens on the buffer's thread.
+            // The body editor sorts by the same capture, so its order follows the simulation at no extra cost.
+            if (rewind_enabled && physicsTicks > 0 && realTimeElapsed - lastRewindCapture >= rewind_interval && rewind.Ready()) {
+                TraceZone zone("Rewind capture");
+                bodyQuerySource = captureBodies();
+                bodyQueryCaptured = true;
+                rewind.Submit(bodyQuerySource->state);
+                lastRewindCapture = realTimeElapsed;
+            }
+
+            // Checkpoints go to the snapshot file; the write happens on the writer thread
+            if (checkpoint_minutes > 0.0f && realTimeElapsed - lastCheckpoint >= checkpoint_minutes * 60.0 && !snapshotWriter.Busy()) {
+                TraceZone zone("Checkpoint");
+                snapshotWriter.Save(snapshot_path, captureSnapshot());
+                lastCheckpoint = realTimeElapsed;
+            }
+            tickInterpolation = tickAccumulator / tickLength;
+            frameStats.Add("Physics", static_cast<float>(physicsZone.End()));
+            physicsAllocations.End();
+
+            // TUNE QUALITY FOR THE NEXT FRAME
+            governor.Update({deltaTime * 1000.0f, deltaTime * physicsRate, octree_build_ms,
+                             force_calculation_ms, vel_pos_update_ms},
+                            theta, stepsPerOctreeRebuild, stepsPerVisualFrame);
         } else {
             frameSimTime = 0;
+            tickInterpolation = 1.0; // show edits made while paused as they are
         }
 
-        numObjects = celestialBodies.size();
+        numObjects = celestialBodies.Size();
 
         // DO IMGUI THINGS
-        start = std::chrono::high_resolution_clock::now();
+        TraceZone uiZone("UI");
+        AllocationZone uiAllocations("UI");
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        glClearColor(0.0f, 0.02f, 0.02f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
         {
             ImGui::Begin("Controls");
 
@@ -580,12 +1539,34 @@ int main() {
 
             // Time step control
             ImGui::SliderFloat("Time Step (seconds)", &time_step, 60.0f, 365*3600*24.0f, "%.1f");
+            ImGui::SliderFloat("Physics Rate (Hz)", &physicsRate, 1.0f, 240.0f, "%.0f");
 
             ImGui::SliderInt("Steps per Octree Rebuild", &stepsPerOctreeRebuild, 1, 50);
             ImGui::SliderInt("Subdivisions", &stepsPerVisualFrame, 1, 100);
 
             ImGui::SliderFloat("Theta", &theta, 0.1f, 2.0f, "%.1f");
 
+            ImGui::Checkbox("Auto-tune to frame budget", &governor.enabled);
+            if (governor.enabled) {
+                ImGui::SliderFloat("Target frame time (ms)", &governor.targetFrameMs, 8.0f, 100.0f, "%.1f");
+                ImGui::SliderFloat("Max Theta", &governor.maxTheta, 0.1f, 2.0f, "%.1f");
+                ImGui::SliderInt("Min Subdivisions", &governor.minStepsPerVisualFrame, 1, 100);
+                ImGui::SliderInt("Max Steps per Octree Rebuild", &governor.maxStepsPerOctreeRebuild, 1, 50);
+            }
+
+            ImGui::Checkbox("Skybox", &show_skybox);
+            ImGui::SameLine();
+            if (ImGui::Checkbox("Orbit trails", &show_trails)) {
+                trails->Reset();
+            }
+            if (show_trails && !trails->Status().empty()) {
+                ImGui::TextWrapped("%s", trails->Status().c_str());
+            }
+
+            if (bodyRenderer->SupportsIndirect()) {
+                ImGui::Checkbox("Multi-draw indirect", &bodyRenderer->useIndirect);
+            }
+
             if (ImGui::Button("Create New Body")) {
                 show_create_body_menu = true;
             }
@@ -601,6 +1582,12 @@ int main() {
             if (ImGui::Button("Show Data Menu")) {
                 show_data = true;
             }
+            if (ImGui::Button("Show Playback")) {
+                show_playback = true;
+            }
+            if (ImGui::Button("Show Rewind")) {
+                show_rewind = true;
+            }
 
             if (ImGui::Button("Create Sun")) {
                 create_sun();
@@ -608,14 +1595,61 @@ int main() {
             if (ImGui::Button("Create Earth")) {
                 create_earth();
             }
-            if (ImGui::Button("Create 10000")) {
-                create_10000();
+            ImGui::Combo("Model", &generator_model, generatorModelNames, generatorModelCount);
+            ImGui::InputInt("Bodies", &generator_count, 1000, 100000);
+            ImGui::InputInt("Seed", &generator_seed);
+            ImGui::InputDouble("Scale radius (Mm)", &generator_radius, 0.0, 0.0, "%.1f");
+            ImGui::InputDouble("Total mass (Rg)", &generator_mass, 0.0, 0.0, "%.3e");
+            if (ImGui::Button("Generate")) {
+                GeneratorOptions options = generatorOptions();
+                submitLoad(jobs, *trails, "Generate " + std::to_string(options.count) + " bodies (" + generatorModelNames[options.model] + ")", false,
+                    [options](LoadedBodies& out, JobProgress& progress) { return generateBodies(options, out, progress.Fraction()); });
+            }
+            if (shipMeshId != SPHERE_MESH && ImGui::Button("Create 1000 Ships")) {
+                create_ships(1000);
             }
 
             ImGui::Text("%.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 
             ImGui::End();
         }
+        if (show_prediction) {
+            ImGui::Begin("Prediction", &show_prediction);
+            size_t targetIndex = celestialBodies.IndexOf(predictionTarget);
+            if (targetIndex == SIZE_MAX) {
+                ImGui::Text("Pick a body with Predict in the body editor");
+            } else {
+                ImGui::Text("Predicting body %u%s", predictionTarget.slot, predictor.Busy() ? " (integrating)" : "");
+            }
+            predictionChanged |= ImGui::SliderFloat("Days ahead", &prediction_days, 0.1f, 365.0f, "%.1f");
+            predictionChanged |= ImGui::SliderInt("Bodies in the model", &prediction_massive, 1, 1024);
+            ImGui::SliderFloat("Refresh every (s)", &prediction_refresh, 0.1f, 5.0f, "%.1f");
+            if (targetIndex != SIZE_MAX && ImGui::Button("Stop Predicting")) {
+                predictionTarget = BodyHandle();
+                predictionChanged = true;
+            }
+            ImGui::End();
+        }
+        if (!show_prediction && predictionTarget != BodyHandle()) {
+            predictionTarget = BodyHandle(); // closing the window ends the prediction
+            predictionChanged = true;
+        }
+
+        // Work started from the UI, with its progress; the window only exists while a job is in flight
+        std::vector<JobInfo> jobInfos = jobs.Jobs();
+        if (!jobInfos.empty()) {
+            ImGui::Begin("Jobs");
+            for (const JobInfo& job : jobInfos) {
+                ImGui::PushID(static_cast<int>(job.id));
+                ImGui::Text("%s (%.1f s)", job.name.c_str(), job.seconds);
+                ImGui::ProgressBar(job.finished ? 1.0f : job.progress, ImVec2(-1.0f, 0.0f), job.finished ? "Finishing" : nullptr);
+                if (!job.finished && ImGui::SmallButton("Cancel")) {
+                    jobs.Cancel(job.id);
+                }
+                ImGui::PopID();
+            }
+            ImGui::End();
+        }
         if (show_data) {
             ImGui::Begin("Data", &show_data);
 
@@ -638,6 +1672,61 @@ int main() {
             // Display real time elapsed
             ImGui::Text("Real time elapsed: %.2f seconds", realTimeElapsed);
 
+            ImGui::Separator();
+            ImGui::InputText("Snapshot file", snapshot_path, sizeof(snapshot_path));
+            if (ImGui::Button("Save Snapshot")) {
+                snapshotWriter.Save(snapshot_path, captureSnapshot());
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Load Snapshot")) {
+                std::string path = snapshot_path;
+                submitLoad(jobs, *trails, "Load " + path, true, [path](LoadedBodies& out, JobProgress&) { return readSnapshot(path, out); });
+            }
+            ImGui::SliderFloat("Checkpoint every (minutes)", &checkpoint_minutes, 0.0f, 120.0f, "%.0f");
+
+            ImGui::Separator();
+            ImGui::InputText("Import file", import_path, sizeof(import_path));
+            ImGui::Combo("Units", &import_units, "By format\0Mm, Mm/s, Rg\0kpc, km/s, 1e10 Msun (Gadget)\0");
+            ImGui::Checkbox("Replace current bodies", &import_replace);
+            if (ImGui::Button("Import")) {
+                std::string path = import_path;
+                int units = import_units;
+                submitLoad(jobs, *trails, "Import " + path, import_replace,
+                    [path, units](LoadedBodies& out, JobProgress&) { return importBodies(path, units, out); });
+            }
+
+            ImGui::Separator();
+            if (!trajectory.IsOpen()) {
+                ImGui::InputText("Trajectory file", trajectory_path, sizeof(trajectory_path));
+                ImGui::SliderInt("Record every N ticks", &trajectory_cadence, 1, 100);
+                ImGui::InputFloat("Position precision (Mm)", &trajectory_precision, 0.0f, 0.0f, "%.1e");
+                ImGui::Checkbox("Record velocities", &trajectory_velocities);
+                if (ImGui::Button("Start Recording")) {
+                    TrajectoryOptions options;
+                    options.positionStep = std::max(static_cast<double>(trajectory_precision), 1e-12);
+                    options.velocities = trajectory_velocities;
+                    ticksSinceTrajectoryFrame = trajectory_cadence; // the first tick records right away
+                    trajectory.Open(trajectory_path, options);
+                }
+            } else {
+                if (ImGui::Button("Stop Recording")) {
+                    trajectory.Close();
+                }
+                ImGui::SameLine();
+                ImGui::Text("Recording to %s", trajectory_path);
+            }
+            if (trajectory.FramesWritten() > 0) {
+                ImGui::Text("%llu frames, %.1f MB (%.1fx smaller than raw), %llu dropped",
+                            static_cast<unsigned long long>(trajectory.FramesWritten()), trajectory.BytesWritten() / 1e6,
+                            trajectory.RawBytes() / std::max(1.0, static_cast<double>(trajectory.BytesWritten())),
+                            static_cast<unsigned long long>(trajectory.FramesDropped()));
+            }
+            if (snapshotWriter.Busy()) {
+                ImGui::Text("Saving...");
+            } else if (!snapshotWriter.LastPath().empty()) {
+                ImGui::Text(snapshotWriter.LastSucceeded() ? "Saved %s" : "Could not save %s", snapshotWriter.LastPath().c_str());
+            }
+
             // Calculate and display current simulation speed
             double currentSimulationSpeed = (frameSimTime / deltaTime);
             if (currentSimulationSpeed < 1) {
@@ -664,14 +1753,162 @@ int main() {
 
             ImGui::End();
         }
+        if (show_rewind) {
+            ImGui::Begin("Rewind", &show_rewind);
+
+            ImGui::Checkbox("Record history", &rewind_enabled);
+            ImGui::SliderFloat("Capture every (seconds)", &rewind_interval, 0.05f, 5.0f, "%.2f");
+            if (ImGui::SliderInt("Memory limit (MB)", &rewind_memory_mb, 16, 4096)) {
+                rewind.SetMemoryLimit(static_cast<size_t>(rewind_memory_mb) * 1024 * 1024);
+            }
+
+            size_t rewindCount = rewind.Count();
+            ImGui::Text("%zu states, %.1f of %d MB", rewindCount, rewind.MemoryUsed() / (1024.0 * 1024.0), rewind_memory_mb);
+            if (rewindCount > 0) {
+                // Scrubbing restores states right away and pauses; resuming continues from the restored state
+                rewindSelection = std::min(rewindSelection, static_cast<int>(rewindCount) - 1);
+                char timeLabel[64];
+                std::snprintf(timeLabel, sizeof(timeLabel), "%.2f days", rewind.Time(rewindSelection) / 86400.0);
+                if (ImGui::SliderInt("Timeline", &rewindSelection, 0, static_cast<int>(rewindCount) - 1, timeLabel)) {
+                    SnapshotData state;
+                    if (rewind.Restore(rewindSelection, state)) {
+                        restoreRewindState(state);
+                        isPaused = true;
+                        trails->Reset();
+                        numObjects = celestialBodies.Size();
+                    }
+                }
+            } else {
+                ImGui::Text("States are captured while the simulation runs");
+            }
+
+            ImGui::End();
+        }
+        if (show_playback) {
+            ImGui::Begin("Playback", &show_playback);
+
+            if (playback == nullptr) {
+                ImGui::InputText("Trajectory file", playback_path, sizeof(playback_path));
+                if (ImGui::Button("Open")) {
+                    playback = std::make_unique<TrajectoryReader>(playback_path);
+                    if (playback->Valid()) {
+                        isPaused = true; // the live simulation waits until playback is closed
+                        playbackFrame = 0.0f;
+                        lastPlaybackFrame = -1.0f;
+                        playbackPlaying = true;
+                        playbackLoaded[0] = playbackLoaded[1] = SIZE_MAX;
+                    } else {
+                        std::cout << "Could not open trajectory " << playback_path << ": " << playback->Error() << std::endl;
+                        playback.reset();
+                    }
+                }
+            } else {
+                float finalFrame = static_cast<float>(playback->FrameCount() - 1);
+                ImGui::Text("Frame %.0f of %zu, simulated time %.2f days", playbackFrame + 1, playback->FrameCount(),
+                            playback->FrameTime(static_cast<size_t>(playbackFrame)) / 86400.0);
+                if (ImGui::Button(playbackPlaying ? "Pause##playback" : "Play##playback")) {
+                    playbackPlaying = !playbackPlaying;
+                    if (playbackPlaying && playback_speed > 0.0f && playbackFrame >= finalFrame) {
+                        playbackFrame = 0.0f; // replay from the start
+                    }
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Close Playback")) {
+                    playback.reset();
+                    playbackPlaying = false;
+                    bodiesChanged = true; // back to the live bodies
+                } else {
+                    ImGui::SliderFloat("Speed (frames/s)", &playback_speed, -120.0f, 120.0f, "%.0f");
+                    ImGui::SliderFloat("Frame", &playbackFrame, 0.0f, finalFrame, "%.0f");
+                }
+            }
+
+            ImGui::End();
+        }
         if (show_performance) {
             ImGui::Begin("Performance", &show_performance);
 
-            ImGui::Text("Building octree took %i microseconds", octree_build_time);
-            ImGui::Text("Calculating forces took %i microseconds", force_calculation_time*stepsPerVisualFrame);
-            ImGui::Text("Calculating velocities and positions took %i microseconds", vel_pos_update_time*stepsPerVisualFrame);
-            ImGui::Text("Rendering ImGui took %i microseconds", imgui_render_time);
-            ImGui::Text("Rendering with OpenGL took %i microseconds", opengl_render_time);
+            // Zones of the shown frames, copied while not frozen; the totals are for the newest complete frame
+            if (!trace_freeze || timeline.empty()) {
+                timelineTo = Tracer::FrameStart(0);
+                timelineFrom = Tracer::FrameStart(trace_frames);
+                timeline = Tracer::Collect(timelineFrom, timelineTo);
+                zoneTotals = Tracer::Totals(Tracer::FrameStart(1), timelineTo);
+            }
+            if (ImGui::CollapsingHeader("Render passes", ImGuiTreeNodeFlags_DefaultOpen)) {
+                drawGpuPasses(*gpuTimer, cpuFrameMs);
+            }
+            if (ImGui::CollapsingHeader("Frame statistics", ImGuiTreeNodeFlags_DefaultOpen)) {
+                drawFrameStats(frameStats);
+            }
+            if (ImGui::CollapsingHeader("Hardware counters")) {
+                drawPerfCounters();
+            }
+            if (ImGui::CollapsingHeader("Memory")) {
+                std::vector<MemoryUsage> usage = simulationMemory(octree);
+                usage.push_back({"Point vertices", pointVertices.capacity() * sizeof(float)});
+                usage.push_back({"Mesh instances", bodyRenderer->MemoryBytes()});
+                usage.push_back({"Ship mesh", shipMesh.vertices.capacity() * sizeof(float) + shipMesh.indices.capacity() * sizeof(unsigned int)});
+                usage.push_back({"Predicted path", predictedPath.capacity() * sizeof(glm::dvec3) + pathVertices.capacity() * sizeof(float)});
+                usage.push_back({"Rewind history", rewind.MemoryUsed()});
+                drawMemoryStats(usage);
+            }
+            if (ImGui::BeginTable("Zones", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+                ImGui::TableSetupColumn("Zone");
+                ImGui::TableSetupColumn("Calls");
+                ImGui::TableSetupColumn("Total ms");
+                ImGui::TableSetupColumn("Max ms");
+                ImGui::TableHeadersRow();
+                for (const ZoneTotal& zone : zoneTotals) {
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::TextUnformatted(zone.name);
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::Text("%llu", static_cast<unsigned long long>(zone.count));
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::Text("%.3f", zone.totalMs);
+                    ImGui::TableSetColumnIndex(3);
+                    ImGui::Text("%.3f", zone.maxMs);
+                }
+                ImGui::EndTable();
+            }
+            ImGui::Text("Rendering at %dx%d with %dx MSAA (%.0f%% scale, %.1f ms average frame)",
+                        renderTarget->Width(), renderTarget->Height(), renderTarget->Samples(),
+                        dynamicResolution.Scale() * 100.0f, dynamicResolution.AverageMs());
+            ImGui::Checkbox("Dynamic resolution", &dynamicResolution.enabled);
+            ImGui::SliderFloat(gpuTimer->Available() ? "GPU budget (ms)###Budget" : "Frame budget (ms)###Budget", &dynamicResolution.budgetMs, 8.0f, 100.0f, "%.1f");
+            ImGui::Text("Physics takes %.2f of %.2f ms available, last adjustment: %s",
+                        governor.PhysicsMs(), governor.PhysicsBudgetMs(), governor.LastAction());
+            ImGui::Text("Bodies took %i draw calls for %i meshes (%s)", bodyRenderer->DrawCalls(), bodyRenderer->MeshCount(),
+                        bodyRenderer->useIndirect && bodyRenderer->SupportsIndirect() ? "multi-draw indirect" : "instanced");
+
+            if (ImGui::CollapsingHeader("Timeline", ImGuiTreeNodeFlags_DefaultOpen)) {
+                if (ImGui::Checkbox("Record zones", &trace_enabled)) {
+                    Tracer::SetEnabled(trace_enabled);
+                }
+                ImGui::SameLine();
+                ImGui::Checkbox("Freeze", &trace_freeze);
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(100.0f);
+                ImGui::SliderInt("Frames", &trace_frames, 1, 16);
+                drawTimeline(timeline, timelineFrom, timelineTo);
+
+                // Everything still in the per-thread buffers, a few seconds at least, written on a job thread
+                ImGui::InputText("Trace file", trace_path, sizeof(trace_path));
+                if (ImGui::Button("Export Chrome Trace")) {
+                    auto traces = std::make_shared<std::vector<ThreadTrace>>(Tracer::Collect(0, Tracer::Now()));
+                    std::string path = trace_path;
+                    jobs.Submit("Export trace to " + path,
+                        [traces, path](JobProgress&) {
+                            if (!Tracer::ExportChromeTrace(path, *traces)) {
+                                std::cout << "Could not write trace " << path << std::endl;
+                                return false;
+                            }
+                            return true;
+                        },
+                        []() {});
+                }
+            }
 
             ImGui::End();
         }
@@ -681,10 +1918,29 @@ int main() {
 
             ImGui::Text("Steps per Octree Rebuild: Rebuilding octrees is computationally expensive. Smaller values are more accurate, especially with rapid or chaotic motion.");
             ImGui::Spacing();
-            ImGui::Text("Subdivisions: This allows you to subdivide the computation in between frames. Use this to improve accuracy at the cost of performance.");
+            ImGui::Text("Subdivisions: This allows you to subdivide each physics tick into smaller steps. Use this to improve accuracy at the cost of performance.");
+            ImGui::Spacing();
+            ImGui::Text("Physics Rate: Physics advances in fixed ticks, this many per real second, no matter how fast frames are drawn. Rendering blends between the last two ticks, so a rate below the frame rate still moves smoothly.");
             ImGui::Spacing();
             ImGui::Text("Theta: This is the Barnes-Hut opening angle and controls performance vs accuracy tradeoff. Smaller values are more accurate but approach O(n^2) territory.");
             ImGui::Spacing();
+            ImGui::Text("Auto-tune: Adjusts theta, subdivisions and octree rebuilds every frame to hold the target frame time. It never goes past the max theta, min subdivisions and max steps per rebuild you set.");
+            ImGui::Spacing();
+            ImGui::Text("Trajectories: Records the position of every body every few physics ticks, rounded to the chosen precision and compressed in the background. If the disk cannot keep up, frames are dropped rather than slowing the simulation.");
+            ImGui::Spacing();
+            ImGui::Text("Rewind: Keeps compressed states of the last moments of the run in memory, up to the memory limit. Drag the timeline to go back, change settings like theta and resume from there.");
+            ImGui::Spacing();
+            ImGui::Text("Playback: Replays a recorded trajectory at any speed, forwards or backwards, without running physics. Drag the frame slider to jump anywhere in the recording.");
+            ImGui::Spacing();
+            ImGui::Text("Snapshots: Saves every body, the simulated time and these settings to one file in the background. Loading maps the file and restarts from it; start with --load <file> to resume a checkpoint.");
+            ImGui::Text("Import: Adds bodies from a Gadget-2 snapshot, a CSV file with x,y,z,vx,vy,vz,mass columns or a .bin file of a uint64 count and those seven double columns. Gadget files are converted from kpc, km/s and 1e10 Msun unless told otherwise; start with --import <file> to begin from one.");
+            ImGui::Text("Prediction: Predict in the body editor draws where that body goes over the next days. Only the heaviest bodies are integrated, with large steps and on their own thread, and the path is refreshed as the simulation runs.");
+            ImGui::Text("Jobs: Generating, importing and loading snapshots run in the background while the simulation keeps going. Their bodies are added at the start of the next frame once they are ready, in the order they were started.");
+            ImGui::Text("Generate: Adds a uniform sphere, Plummer or Hernquist cluster, exponential disk or cold collapse of the given size, built on every core. The same seed gives the same bodies; start with --generate <model> --count <N> --seed <S> to begin from one.");
+            ImGui::Text("Timeline: The Performance window keeps min, mean, median, 99th percentile and max of every phase over the last 600 frames, and shows how long each phase of the last frames took on every thread. Freeze it to hover over zones, or export the recent history as a trace for chrome://tracing or Perfetto.");
+            ImGui::Text("Hardware counters: Counts cycles, instructions, cache and branch misses for the octree build, the force pass of every thread and integration. Linux only, and only where the kernel allows unprivileged counting; --headless <ticks> --report <file> runs physics without a window and writes the same numbers with timing statistics.");
+            ImGui::Text("Memory: The Performance window shows the bytes each part of the simulation holds, per body, and how many heap allocations each phase made in the last frame. --headless <ticks> --check-allocations fails when a physics tick still allocates after the first half of the run.");
+            ImGui::Spacing();
             ImGui::Text("Simulation speed: This is dynamically computed as the ratio between simulation time and real time. It may look hard-coded due to its unwavering accuracy. It's not.");
             ImGui::End();
         }
@@ -692,86 +1948,157 @@ int main() {
         {
             ImGui::Begin("Celestial Bodies Editor", &show_table ); // the bool reference makes an x to close out the window and reset the bool
 
-            if (ImGui::BeginTable("Bodies Table", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY))
+            // Only the rows in view are built; filtering and sorting run on a worker over a snapshot of the bodies
+            bool queryChanged = ImGui::InputText("Search ID (e.g. 42 or 100-200)", body_search, sizeof(body_search));
+            queryChanged |= ImGui::InputDouble("Min mass (Rg)", &body_min_mass, 0.0, 0.0, "%.3e");
+            queryChanged |= ImGui::InputDouble("Max mass (Rg)", &body_max_mass, 0.0, 0.0, "%.3e");
+            bodyQuery.Poll();
+            const std::vector<BodyHandle>& bodyRows = bodyQuery.Handles();
+            ImGui::Text("Showing %zu of %zu bodies%s", bodyRows.size(), celestialBodies.Size(), bodyQuery.Busy() ? " (updating)" : "");
+
+            // Rows are handles, so they keep referring to the same bodies while a query is in flight after a removal.
+            // Deletions are collected and removed in one batch after the table, so the rows stay valid while it is drawn.
+            std::vector<BodyHandle> removedBodies;
+            bool bodyEdited = false;
+            if (ImGui::BeginTable("Bodies Table", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Sortable))
             {
                 ImGui::TableSetupScrollFreeze(0, 1);
-                ImGui::TableSetupColumn("ID");
+                ImGui::TableSetupColumn("ID", ImGuiTableColumnFlags_DefaultSort);
                 ImGui::TableSetupColumn("Position (Mm)");
                 ImGui::TableSetupColumn("Velocity (Mm/s)");
                 ImGui::TableSetupColumn("Force (N)");
                 ImGui::TableSetupColumn("Mass (Rg)");
                 ImGui::TableSetupColumn("Radius (Mm)");
-                ImGui::TableSetupColumn("Color");
+                ImGui::TableSetupColumn("Color", ImGuiTableColumnFlags_NoSort);
                 ImGui::TableHeadersRow();
 
-                for (size_t i = 0; i < celestialBodies.size(); i++)
-                {
-                    auto& body = celestialBodies[i];
-                    ImGui::TableNextRow();
-                    ImGui::TableNextColumn();
-                    ImGui::Text("%zu", i);
-
-                    ImGui::TableNextColumn();
-                    {
-                        ImGui::PushID((int)(i * 7 + 0)); // this is very hacky but it works for now
-                        ImGui::InputDouble("X", &body.position.x, 0.0, 0.0, "%.2f");
-                        ImGui::InputDouble("Y", &body.position.y, 0.0, 0.0, "%.2f");
-                        ImGui::InputDouble("Z", &body.position.z, 0.0, 0.0, "%.2f");
-                        ImGui::PopID();
+                ImGuiTableSortSpecs* sortSpecs = ImGui::TableGetSortSpecs();
+                if (sortSpecs != nullptr && sortSpecs->SpecsDirty) {
+                    if (sortSpecs->SpecsCount > 0) {
+                        body_sort_column = sortSpecs->Specs[0].ColumnIndex;
+                        body_sort_descending = sortSpecs->Specs[0].SortDirection == ImGuiSortDirection_Descending;
                     }
+                    sortSpecs->SpecsDirty = false;
+                    queryChanged = true;
+                }
 
-                    ImGui::TableNextColumn();
-                    {
-                        ImGui::PushID((int)(i * 7 + 1));
-                        ImGui::InputDouble("X", &body.velocity.x, 0.0, 0.0, "%.2f");
-                        ImGui::InputDouble("Y", &body.velocity.y, 0.0, 0.0, "%.2f");
-                        ImGui::InputDouble("Z", &body.velocity.z, 0.0, 0.0, "%.2f");
-                        ImGui::PopID();
-                    }
+                // The query reads the newest rewind capture, so the order follows the running simulation without the
+                // table copying anything. Only adding or removing bodies makes the table take a capture of its own;
+                // values edited since a capture show live in the rows but sort by the captured ones.
+                if (bodyQuerySource == nullptr || bodyQuerySource->revision != celestialBodies.Revision()) {
+                    bodyQuerySource = captureBodies();
+                    bodyQueryCaptured = true;
+                }
+                if (queryChanged || bodyQueryCaptured) {
+                    bodyQuery.Submit(bodyQuerySource, body_sort_column, body_search, body_min_mass, body_max_mass, body_sort_descending);
+                    bodyQueryCaptured = false;
+                }
 
-                    ImGui::TableNextColumn();
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(bodyRows.size()));
+                while (clipper.Step())
+                {
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++)
                     {
-                        ImGui::PushID((int)(i * 7 + 2));
-                        ImGui::InputDouble("X", &body.force.x, 0.0, 0.0, "%.2e");
-                        ImGui::InputDouble("Y", &body.force.y, 0.0, 0.0, "%.2e");
-                        ImGui::InputDouble("Z", &body.force.z, 0.0, 0.0, "%.2e");
+                        BodyHandle handle = bodyRows[row];
+                        ImGui::TableNextRow();
+                        size_t index = celestialBodies.IndexOf(handle);
+                        if (index == SIZE_MAX) {
+                            continue; // removed since the order was computed
+                        }
+                        auto& body = celestialBodies[index];
+                        // The slot is the body's ID: it stays the same while the body exists, wherever it moves
+                        size_t i = handle.slot;
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%zu", i);
+                        ImGui::PushID((int)(i * 7 + 6));
+                        if (ImGui::SmallButton("Delete")) {
+                            removedBodies.push_back(handle);
+                        }
+                        ImGui::SameLine();
+                        if (ImGui::SmallButton("Predict")) {
+                            predictionTarget = handle;
+                            predictionChanged = true;
+                            show_prediction = true;
+                        }
                         ImGui::PopID();
-                    }
 
-                    ImGui::TableNextColumn();
-                    {
-                        ImGui::PushID((int)(i * 7 + 3));
-                        if (ImGui::InputDouble("##Mass", &body.mass, 0.0, 0.0, "%.3e"))
+                        ImGui::TableNextColumn();
                         {
-                            if (body.mass <= 0) body.mass = std::numeric_limits<double>::min();
+                            ImGui::PushID((int)(i * 7 + 0)); // this is very hacky but it works for now
+                            bodyEdited |= ImGui::InputDouble("X", &body.position.x, 0.0, 0.0, "%.2f");
+                            bodyEdited |= ImGui::InputDouble("Y", &body.position.y, 0.0, 0.0, "%.2f");
+                            bodyEdited |= ImGui::InputDouble("Z", &body.position.z, 0.0, 0.0, "%.2f");
+                            ImGui::PopID();
                         }
-                        ImGui::PopID();
-                    }
 
-                    ImGui::TableNextColumn();
-                    {
-                        ImGui::PushID((int)(i * 7 + 4));
-                        if (ImGui::InputDouble("##Radius", &body.radius, 0.0, 0.0, "%.2f"))
+                        ImGui::TableNextColumn();
                         {
-                            if (body.radius <= 0) body.radius = std::numeric_limits<double>::min();
+                            ImGui::PushID((int)(i * 7 + 1));
+                            bodyEdited |= ImGui::InputDouble("X", &body.velocity.x, 0.0, 0.0, "%.2f");
+                            bodyEdited |= ImGui::InputDouble("Y", &body.velocity.y, 0.0, 0.0, "%.2f");
+                            bodyEdited |= ImGui::InputDouble("Z", &body.velocity.z, 0.0, 0.0, "%.2f");
+                            ImGui::PopID();
                         }
-                        ImGui::PopID();
-                    }
 
-                    ImGui::TableNextColumn();
-                    {
-                        ImGui::PushID((int)(i * 7 + 5));
-                        float color[3] = {body.color.r, body.color.g, body.color.b};
-                        if (ImGui::ColorEdit3("##Color", color, ImGuiColorEditFlags_NoInputs))
+                        ImGui::TableNextColumn();
                         {
-                            body.color = glm::vec3(color[0], color[1], color[2]);
+                            ImGui::PushID((int)(i * 7 + 2));
+                            bodyEdited |= ImGui::InputDouble("X", &body.force.x, 0.0, 0.0, "%.2e");
+                            bodyEdited |= ImGui::InputDouble("Y", &body.force.y, 0.0, 0.0, "%.2e");
+                            bodyEdited |= ImGui::InputDouble("Z", &body.force.z, 0.0, 0.0, "%.2e");
+                            ImGui::PopID();
+                        }
+
+                        ImGui::TableNextColumn();
+                        {
+                            ImGui::PushID((int)(i * 7 + 3));
+                            if (ImGui::InputDouble("##Mass", &body.mass, 0.0, 0.0, "%.3e"))
+                            {
+                                if (body.mass <= 0) body.mass = std::numeric_limits<double>::min();
+                                bodyEdited = true;
+                            }
+                            ImGui::PopID();
+                        }
+
+                        ImGui::TableNextColumn();
+                        {
+                            ImGui::PushID((int)(i * 7 + 4));
+                            if (ImGui::InputDouble("##Radius", &body.radius, 0.0, 0.0, "%.2f"))
+                            {
+                                if (body.radius <= 0) body.radius = std::numeric_limits<double>::min();
+                                bodyEdited = true;
+                            }
+                            ImGui::PopID();
+                        }
+
+                        ImGui::TableNextColumn();
+                        {
+                            ImGui::PushID((int)(i * 7 + 5));
+                            float color[3] = {body.color.r, body.color.g, body.color.b};
+                            if (ImGui::ColorEdit3("##Color", color, ImGuiColorEditFlags_NoInputs))
+                            {
+                                body.color = glm::vec3(color[0], color[1], color[2]);
+                                bodyEdited = true;
+                            }
+                            ImGui::PopID();
                         }
-                        ImGui::PopID();
                     }
                 }
                 ImGui::EndTable();
             }
 
+            if (bodyEdited) {
+                bodiesChanged = true;
+                octree.stale = true; // moved or reweighed bodies no longer match the tree's sums
+            }
+            if (!removedBodies.empty()) {
+                celestialBodies.Remove(removedBodies.data(), removedBodies.size());
+                bodiesChanged = true;
+                trails->Reset();
+                numObjects = celestialBodies.Size();
+            }
+
             ImGui::End();
         }
         if (show_create_body_menu) {
@@ -791,38 +2118,156 @@ int main() {
             ImGui::InputDouble("Mass (Rg)", &new_body_mass, 1e-6, 1e-3, "%.3e");
 
             ImGui::ColorEdit3("Color", &new_body_color[0]);
+            ImGui::InputText("Texture (optional)", new_body_texture, sizeof(new_body_texture));
 
             if (ImGui::Button("Create Body")) {
-                createNewBody(celestialBodies);
-                numObjects = celestialBodies.size();
+                BodyHandle created = createNewBody(celestialBodies);
+                if (new_body_texture[0] != '\0') {
+                    celestialBodies.Get(created)->textureId = textures->Request(new_body_texture); // decoded in the background
+                }
+                numObjects = celestialBodies.Size();
                 show_create_body_menu = false;
             }
 
             ImGui::End();
         }
 
-        finish = std::chrono::high_resolution_clock::now();
-        time =  std::chrono::duration_cast<std::chrono::microseconds>(finish-start).count();
-        // std::cout << "ImGUI setup took: " << time << " microseconds\n";
-        imgui_render_time = time;
+        frameStats.Add("UI", static_cast<float>(uiZone.End()));
+        uiAllocations.End();
 
         // DO GRAPHICS STUFF
-        start = std::chrono::high_resolution_clock::now();
+        TraceZone renderZone("Render");
+        AllocationZone renderAllocations("Render");
         camera.Inputs(window);
+
+        // Render the scene offscreen at the size the resolution controller picked
+        int windowWidth, windowHeight;
+        glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
+        // Resolution and MSAA only change what the GPU does, so they follow GPU time once the timer has results;
+        // a CPU-bound frame keeps its resolution. The frame time is all there is before that.
+        gpuTimer->BeginFrame();
+        if (gpuTimer->Available()) {
+            frameStats.Add("GPU", gpuTimer->GpuMs());
+        }
+        if (!waitedForEvents) { // time spent asleep says nothing about how long rendering takes
+            dynamicResolution.Update(gpuTimer->Available() ? gpuTimer->GpuMs() : deltaTime * 1000.0f);
+        }
+        renderTarget->Resize(static_cast<int>(windowWidth * dynamicResolution.Scale()),
+                             static_cast<int>(windowHeight * dynamicResolution.Scale()), dynamicResolution.Samples());
+        renderTarget->Bind();
+        gpuTimer->Begin("Clear");
+        glClearColor(0.0f, 0.02f, 0.02f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        gpuTimer->End();
+
         camera.Matrix(fov, near, far, shader, "camMatrix");
         shader.setVec3("viewPos", camera.Position); // Update view position for specular lighting
 
-        // Update point vertices
-        pointVertices.clear();
-        for (const auto& body : celestialBodies) {
-            pointVertices.push_back(static_cast<float>(body.position.x));
-            pointVertices.push_back(static_cast<float>(body.position.y));
-            pointVertices.push_back(static_cast<float>(body.position.z));
+        // PLAYBACK: recorded frames replace the live positions, decoding only the frames that come into view
+        if (playback != nullptr) {
+            float finalFrame = static_cast<float>(playback->FrameCount() - 1);
+            if (playbackPlaying) {
+                playbackFrame += deltaTime * playback_speed;
+                if (playbackFrame >= finalFrame || playbackFrame <= 0.0f) {
+                    playbackPlaying = false; // stop at either end of the recording
+                }
+            }
+            playbackFrame = std::clamp(playbackFrame, 0.0f, finalFrame);
+            size_t first = static_cast<size_t>(playbackFrame);
+            size_t second = std::min(first + 1, playback->FrameCount() - 1);
+            if (playbackLoaded[0] != first) {
+                if (playbackLoaded[1] == first) { // playing forward, the next frame is already decoded
+                    std::swap(playbackPositions[0], playbackPositions[1]);
+                    std::swap(playbackLoaded[0], playbackLoaded[1]);
+                } else if (playback->ReadPositions(first, playbackPositions[0])) {
+                    playbackLoaded[0] = first;
+                }
+            }
+            if (playbackLoaded[1] != second && playback->ReadPositions(second, playbackPositions[1])) {
+                playbackLoaded[1] = second;
+            }
+        }
+
+        // Only state that changed since the last frame is rebuilt and uploaded
+        bool playbackMoved = playback != nullptr && playbackFrame != lastPlaybackFrame;
+        lastPlaybackFrame = playback != nullptr ? playbackFrame : -1.0f;
+        bool positionsChanged = bodiesChanged || physicsTicks > 0 || tickInterpolation != lastInterpolation || playbackMoved;
+        bool cameraMoved = camera.Position != lastCameraPosition || camera.Orientation != lastCameraOrientation;
+        lastInterpolation = tickInterpolation;
+        lastCameraPosition = camera.Position;
+        lastCameraOrientation = camera.Orientation;
+
+        // Predict from the current state when something changed, and now and then while the simulation runs.
+        // The reduced model is the heaviest bodies, picked again only when bodies were added, removed or edited.
+        if (bodiesChanged) {
+            predictionModel.clear();
+            predictionChanged = true;
+        }
+        if (predictionModel.size() != std::min(static_cast<size_t>(prediction_massive), celestialBodies.Size())) {
+            predictionModel.clear(); // the model size changed
+        }
+        if (!celestialBodies.Valid(predictionTarget) || playback != nullptr) {
+            if (!predictedPath.empty() || predictor.Busy()) {
+                predictor.Clear();
+            }
+        } else if (predictionChanged || (physicsTicks > 0 && currentFrame - lastPrediction > prediction_refresh)) {
+            TraceZone zone("Submit prediction");
+            if (predictionModel.empty()) {
+                predictionModel = heaviestBodies(static_cast<size_t>(prediction_massive));
+            }
+            predictor.Submit(predictionRequest(predictionTarget, predictionModel));
+            lastPrediction = currentFrame;
+        }
+        predictionChanged = false;
+        bool pathChanged = predictor.Poll(predictedPath);
+        if (pathChanged) {
+            pathVertices.clear();
+            for (const glm::dvec3& point : predictedPath) {
+                pathVertices.push_back(static_cast<float>(point.x));
+                pathVertices.push_back(static_cast<float>(point.y));
+                pathVertices.push_back(static_cast<float>(point.z));
+            }
+            if (pathVBO == nullptr) {
+                pathVBO = std::make_unique<VBO>(pathVertices.data(), pathVertices.size() * sizeof(float), GL_DYNAMIC_DRAW);
+                pathVAO.Bind();
+                pathVAO.LinkAttrib(*pathVBO, 0, 3, GL_FLOAT, 3 * sizeof(float), (void*)0);
+                pathVAO.Unbind();
+                pathVBO->Unbind();
+            } else {
+                pathVBO->Bind();
+                glBufferData(GL_ARRAY_BUFFER, pathVertices.size() * sizeof(float), pathVertices.data(), GL_DYNAMIC_DRAW);
+                pathVBO->Unbind();
+            }
+        }
+
+        // Update point vertices, placed between the last two physics states so motion stays smooth at any physics rate
+        if (positionsChanged && playback != nullptr) {
+            pointVertices.clear();
+            const std::vector<double>& from = playbackPositions[0];
+            const std::vector<double>& to = playbackPositions[1];
+            double blend = to.size() == from.size() ? playbackFrame - std::floor(playbackFrame) : 0.0;
+            for (size_t i = 0; i < from.size(); i++) {
+                pointVertices.push_back(static_cast<float>(from[i] + (to.size() == from.size() ? (to[i] - from[i]) * blend : 0.0)));
+            }
+        } else if (positionsChanged) {
+            pointVertices.clear();
+            bool interpolate = previousPositions.size() == celestialBodies.Size(); // bodies were added or edited since the last tick otherwise
+            for (size_t i = 0; i < celestialBodies.Size(); i++) {
+                dvec3 position = celestialBodies[i].position;
+                if (interpolate) {
+                    position = glm::mix(previousPositions[i], position, tickInterpolation);
+                }
+                pointVertices.push_back(static_cast<float>(position.x));
+                pointVertices.push_back(static_cast<float>(position.y));
+                pointVertices.push_back(static_cast<float>(position.z));
+            }
         }
 
         // Update or create point VBO
-        if (pointVBO == nullptr) {
-            pointVBO = new VBO(pointVertices.data(), pointVertices.size() * sizeof(float));
+        if (!positionsChanged) {
+            // the buffer already holds these positions
+        } else if (pointVBO == nullptr) {
+            pointVBO = std::make_unique<VBO>(pointVertices.data(), pointVertices.size() * sizeof(float), GL_DYNAMIC_DRAW);
             pointVAO.Bind();
             pointVAO.LinkAttrib(*pointVBO, 0, 3, GL_FLOAT, 3 * sizeof(float), (void*)0);
             pointVAO.Unbind();
@@ -833,32 +2278,156 @@ int main() {
             pointVBO->Unbind();
         }
 
+        // One sample per frame that simulated anything: a single upload of the newest position of every body
+        if (show_trails && physicsTicks > 0) {
+            trails->AddSample(pointVertices.data(), static_cast<int>(pointVertices.size() / 3));
+        }
+
         // Render points
-        pointShader.Activate();
-        camera.Matrix(fov, near, far, pointShader, "camMatrix");
-        pointVAO.Bind();
-        glDrawArrays(GL_POINTS, 0, pointVertices.size() / 3);
-        pointVAO.Unbind();
+        {
+            TraceZone zone("Draw points");
+            gpuTimer->Begin("Points");
+            pointShader.Activate();
+            camera.Matrix(fov, near, far, pointShader, "camMatrix");
+            pointVAO.Bind();
+            glDrawArrays(GL_POINTS, 0, pointVertices.size() / 3);
+            pointVAO.Unbind();
+            gpuTimer->End();
+        }
+
+        // Upload textures that finished decoding; bodies stay untextured until theirs is ready
+        size_t texturesPending = textures->Pending();
+        {
+            TraceZone zone("Upload textures");
+            textures->Update();
+        }
+        bool texturesChanged = textures->Pending() != texturesPending;
+
+        // Queue one instance per body and draw them all with a constant number of draw calls.
+        // Levels of detail depend on the camera, so moving it requeues as well.
+        // A recording only holds positions; its bodies are drawn as meshes only when they line up with the live ones
+        TraceZone bodiesZone("Draw bodies");
+        if (positionsChanged || cameraMoved || texturesChanged) {
+            bodyRenderer->Clear();
+            size_t meshBodies = pointVertices.size() / 3 == celestialBodies.Size() ? celestialBodies.Size() : 0;
+            for (size_t i = 0; i < meshBodies; i++) {
+                const CelestialBody& body = celestialBodies[i];
+                glm::vec3 position(pointVertices[3 * i], pointVertices[3 * i + 1], pointVertices[3 * i + 2]);
+                float scale = static_cast<float>(body.radius * renderScale);
+                GLuint meshId = body.meshId >= 0 ? body.meshId : sphereLodFor(scale, glm::length(position - camera.Position));
+                bodyRenderer->AddInstance(meshId, {position, scale, body.color}, textures->GetID(body.textureId));
+            }
+        }
+        gpuTimer->Begin("Bodies");
+        shader.Activate();
+        bodyRenderer->Draw(shader);
+        gpuTimer->End();
+        bodiesZone.End();
+
+        // The skybox follows the opaque passes so the depth test skips every pixel a body or point already covers,
+        // and precedes the blended ones: trails and the predicted path write no depth, so it would paint over them
+        skybox->Update();
+        if (show_skybox) {
+            gpuTimer->Begin("Skybox");
+            skybox->Draw(skyboxShader, camera.GetViewMatrix(), camera.GetProjectionMatrix(fov, near, far));
+            gpuTimer->End();
+        }
 
-        for (auto& body : celestialBodies) {
-            body.draw(shader);
+        if (show_trails) {
+            gpuTimer->Begin("Trails");
+            glm::mat4 camMatrix = camera.GetProjectionMatrix(fov, near, far) * camera.GetViewMatrix();
+            trails->Draw(trailShader, camMatrix, glm::vec3(0.4f, 0.7f, 1.0f));
+            gpuTimer->End();
         }
 
+        // Blended and without depth writes like the trails, so it has to come after the skybox too
+        if (pathVertices.size() >= 6) {
+            gpuTimer->Begin("Prediction");
+            pathShader.Activate();
+            camera.Matrix(fov, near, far, pathShader, "camMatrix");
+            pathShader.setVec3("pathColor", glm::vec3(1.0f, 0.6f, 0.2f));
+            pathShader.setInt("pointCount", static_cast<int>(pathVertices.size() / 3));
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            pathVAO.Bind();
+            glDrawArrays(GL_LINE_STRIP, 0, static_cast<GLsizei>(pathVertices.size() / 3));
+            pathVAO.Unbind();
+            glDepthMask(GL_TRUE);
+            glDisable(GL_BLEND);
+            gpuTimer->End();
+        }
+
+        // Upscale to the window; ImGui draws on top at full resolution
+        gpuTimer->Begin("Upscale");
+        renderTarget->BlitToScreen(windowWidth, windowHeight);
+        gpuTimer->End();
+
         ImGui::Render();
+        gpuTimer->Begin("ImGui");
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        gpuTimer->End();
+        frameStats.Add("Render", static_cast<float>(renderZone.End()));
+        renderAllocations.End();
+
+        {
+            TraceZone zone("Swap buffers");
+            AllocationZone allocations("Swap buffers");
+            glfwSwapBuffers(window);
+            swapMs = static_cast<float>(zone.End());
+            frameStats.Add("Swap buffers", swapMs);
+        }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-        finish = std::chrono::high_resolution_clock::now();
-        time = std::chrono::duration_cast<std::chrono::microseconds>(finish-start).count();
-        // std::cout << "Rendering stuff took: " << time << " microseconds\n";
-        opengl_render_time = time;
+        // A paused scene that stopped changing sleeps until the next input event instead of redrawing at full speed.
+        // A few frames are still drawn after every event so ImGui can settle hover and click states.
+        bool busy = !isPaused || playbackPlaying || positionsChanged || cameraMoved || texturesPending > 0 || skybox->Loading() || jobs.Busy() || predictor.Busy() || bodyQuery.Busy() || pathChanged;
+        quietFrames = busy ? 0 : quietFrames + 1;
+        waitedForEvents = quietFrames > 2;
+        if (waitedForEvents) {
+            TraceZone zone("Wait for events");
+            glfwWaitEvents();
+            lastFrame = static_cast<float>(glfwGetTime()); // the next frame's delta should not include the sleep
+            quietFrames = 0;
+        } else {
+            glfwPollEvents();
+        }
+
+        // Added, removed or edited bodies invalidate the previous physics state; the octree follows the store itself
+        if (bodiesChanged) {
+            previousPositions.clear();
+            bodiesChanged = false;
+        }
 
-        auto bigFinish = std::chrono::high_resolution_clock::now();
-        // std::cout << "\nOverall, this frame took: " << std::chrono::duration_cast<std::chrono::microseconds>(bigFinish-bigStart).count() << " microseconds\n\n";
+        // A frame that slept waiting for input would only skew the statistics
+        float frameMs = static_cast<float>(frameZone.End());
+        frameAllocations.End();
+        MemoryStats::EndFrame();
+        if (waitedForEvents) {
+            frameStats.DiscardFrame();
+        } else {
+            frameStats.Add("Frame", frameMs);
+            frameStats.EndFrame();
+            cpuFrameMs = frameMs - swapMs;
+        }
     }
 
-    delete pointVBO;
+    // GL objects have to be released while the context is still alive
+    bodyRenderer.reset();
+    bodyMeshes.reset();
+    textures.reset();
+    skybox.reset();
+    trails.reset();
+    renderTarget.reset();
+    gpuTimer.reset();
+    pointVBO.reset();
+    pointVAO.Delete();
+    pathVBO.reset();
+    pathVAO.Delete();
+    shader.Delete();
+    pointShader.Delete();
+    skyboxShader.Delete();
+    trailShader.Delete();
+    pathShader.Delete();
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
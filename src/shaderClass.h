@@ -39,6 +39,14 @@ public:
 		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
 	}
 
+	void setInt(const std::string &name, int value) const {
+		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+	}
+
+	void setBool(const std::string &name, bool value) const {
+		glUniform1i(glGetUniformLocation(ID, name.c_str()), value ? 1 : 0);
+	}
+
 private:
 	// Checks if the different Shaders have compiled properly
 	void compileErrors(unsigned int shader, const char* type);